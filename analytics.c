@@ -0,0 +1,206 @@
+#include "global.h" // (includes analytics.h)
+
+#include <string.h>
+#include <math.h>
+
+
+// partial results of this node (or the combined ones, on the head)
+typedef struct {
+	double density[NUMBER_OF_ORGANISMS][ANALYTICS_CELLS];
+	double moments[NUMBER_OF_ORGANISMS][4]; // sums of x, y, x*x, y*y
+	double proximity[MAX_INTERACTIONS][ANALYTICS_BINS + 1];
+} AnalyticsPartial;
+
+AnalyticsPartial analytics_partial;
+AnalyticsPartial analytics_result; // (head node)
+
+// reduction still running (if any), and its step (head node)
+MPI_Request analytics_request = MPI_REQUEST_NULL;
+int analytics_step = -1;
+
+// the head node's output file
+FILE *analytics_file = NULL;
+
+// predators of a task, for nearest predator queries (grown as needed)
+NeighbourGrid analytics_grid;
+int analytics_grid_capacity = 0;
+
+
+/* ALL NODES: start out with nothing pending; the head node opens the
+ *	output file (if analytics are on).
+ */
+void init_analytics(){
+	if(analytics_interval <= 0 || rank != 0)
+		return;
+	if(analytics_path == NULL)
+		analytics_path = "envsim.analytics";
+	analytics_file = fopen(analytics_path, "w");
+	if(analytics_file == NULL){
+		printf("Error: could not open analytics file %s\n", analytics_path);
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+	fprintf(analytics_file, "# envsim analytics: world %dx%d, density grid %dx%d, ",
+		world_width, world_height, ANALYTICS_GRID, ANALYTICS_GRID);
+	fprintf(analytics_file, "proximity bins of %d pixels (%d, then farther)\n",
+		ANALYTICS_BIN_WIDTH, ANALYTICS_BINS);
+	printf("Analytics every %d steps to %s.\n", analytics_interval,
+		analytics_path);
+}
+
+
+/* HEAD NODE: writes out the combined results of one analysis:
+ *	per species, the population, how clustered it is (the variance to
+ *	mean ratio of the cell counts, 1 for a random spread, and Morisita's
+ *	index, also 1 for a random spread, above 1 when clustered), the
+ *	mean position and its spread, and the cell counts; then the
+ *	nearest predator distances of every interaction.
+ */
+void write_analysis(){
+	AnalyticsPartial *result = &analytics_result;
+	fprintf(analytics_file, "step %d\n", analytics_step);
+	int t, c, i;
+	for(t=0; t<num_species; t++){
+		double *cells = result->density[t];
+		double total = 0;
+		double pairs = 0;
+		for(c=0; c<ANALYTICS_CELLS; c++){
+			total += cells[c];
+			pairs += cells[c] * (cells[c] - 1);
+		}
+		double mean = total / ANALYTICS_CELLS;
+		double variance = 0;
+		for(c=0; c<ANALYTICS_CELLS; c++){
+			variance += (cells[c] - mean) * (cells[c] - mean);
+		}
+		variance /= ANALYTICS_CELLS;
+		double *moments = result->moments[t];
+		double mean_x = (total > 0) ? moments[0] / total : 0;
+		double mean_y = (total > 0) ? moments[1] / total : 0;
+		double spread_x = (total > 0) ? moments[2] / total - mean_x * mean_x : 0;
+		double spread_y = (total > 0) ? moments[3] / total - mean_y * mean_y : 0;
+		fprintf(analytics_file,
+			"density %s %.0f vmr %.3f morisita %.3f mean %.1f %.1f sd %.1f %.1f\n",
+			species[t].name, total, (mean > 0) ? variance / mean : 0,
+			(total > 1) ? ANALYTICS_CELLS * pairs / (total * (total - 1)) : 0,
+			mean_x, mean_y, sqrt(spread_x > 0 ? spread_x : 0),
+			sqrt(spread_y > 0 ? spread_y : 0));
+		fprintf(analytics_file, "cells %s", species[t].name);
+		for(c=0; c<ANALYTICS_CELLS; c++){
+			fprintf(analytics_file, " %.0f", cells[c]);
+		}
+		fprintf(analytics_file, "\n");
+	}
+	for(i=0; i<num_interactions; i++){
+		fprintf(analytics_file, "proximity %s %s",
+			species[interactions[i].predator].name,
+			species[interactions[i].prey].name);
+		for(c=0; c<=ANALYTICS_BINS; c++){
+			fprintf(analytics_file, " %.0f", result->proximity[i][c]);
+		}
+		fprintf(analytics_file, "\n");
+	}
+}
+
+
+/* ALL NODES (when CONTINUE_ANALYTICS is set): finish the last
+ *	reduction (the head node writes it out), and start a new partial.
+ */
+void analytics_begin(){
+	if(analytics_request != MPI_REQUEST_NULL){
+		MPI_Wait(&analytics_request, MPI_STATUS_IGNORE);
+		if(analytics_file != NULL)
+			write_analysis();
+	}
+	memset(&analytics_partial, 0, sizeof(analytics_partial));
+}
+
+
+/* ORGANISM NODES (and the local engine): adds the density histogram
+ *	and moments of some organisms of a species (x, y pairs).
+ */
+void analytics_species(int type, int positions[], int count){
+	double *cells = analytics_partial.density[type];
+	double *moments = analytics_partial.moments[type];
+	int i;
+	for(i=0; i<count; i++){
+		int x = positions[2*i];
+		int y = positions[2*i+1];
+		int column = x * ANALYTICS_GRID / world_width;
+		int row = y * ANALYTICS_GRID / world_height;
+		column = (column < 0) ? 0 : (column >= ANALYTICS_GRID) ? ANALYTICS_GRID - 1 : column;
+		row = (row < 0) ? 0 : (row >= ANALYTICS_GRID) ? ANALYTICS_GRID - 1 : row;
+		cells[row * ANALYTICS_GRID + column]++;
+		moments[0] += x;
+		moments[1] += y;
+		moments[2] += (double)x * x;
+		moments[3] += (double)y * y;
+	}
+}
+
+
+/* COLLISION NODES (and the local engine): adds the distance from every
+ *	prey of an interaction to its nearest predator (all x, y pairs).
+ */
+void analytics_interaction(int task, int prey[], int num_prey,
+		int predators[], int num_predators){
+	double *bins = analytics_partial.proximity[task];
+	int reach = ANALYTICS_BINS * ANALYTICS_BIN_WIDTH;
+	if(num_predators > analytics_grid_capacity){
+		if(analytics_grid_capacity > 0)
+			free_neighbour_grid(&analytics_grid);
+		analytics_grid_capacity = num_predators;
+		init_neighbour_grid(&analytics_grid, reach, analytics_grid_capacity);
+	}
+	if(num_predators == 0){
+		bins[ANALYTICS_BINS] += num_prey;
+		return;
+	}
+	build_neighbour_grid(&analytics_grid, predators, num_predators);
+
+	int i;
+	for(i=0; i<num_prey; i++){
+		int bin = ANALYTICS_BINS;
+		int nearest;
+		if(query_nearest(&analytics_grid, prey[2*i], prey[2*i+1], reach,
+				1, &nearest) == 1){
+			double dx = predators[2*nearest] - prey[2*i];
+			double dy = predators[2*nearest+1] - prey[2*i+1];
+			bin = (int)(sqrt(dx*dx + dy*dy) / ANALYTICS_BIN_WIDTH);
+			if(bin > ANALYTICS_BINS)
+				bin = ANALYTICS_BINS;
+		}
+		bins[bin]++;
+	}
+}
+
+
+/* ALL NODES: start combining the partial results onto the head node
+ *	(of the given step). Nobody waits for it here.
+ */
+void analytics_reduce(int step){
+	analytics_step = step;
+	MPI_Ireduce(&analytics_partial, &analytics_result,
+		sizeof(AnalyticsPartial) / sizeof(double), MPI_DOUBLE, MPI_SUM, 0,
+		sim_comm, &analytics_request);
+	telemetry_sent(sizeof(AnalyticsPartial));
+}
+
+
+/* ALL NODES (when done): finish the last reduction, and close the
+ *	file.
+ */
+void analytics_finish(){
+	if(analytics_request != MPI_REQUEST_NULL){
+		MPI_Wait(&analytics_request, MPI_STATUS_IGNORE);
+		if(analytics_file != NULL)
+			write_analysis();
+	}
+	if(analytics_file != NULL){
+		fclose(analytics_file);
+		analytics_file = NULL;
+	}
+	if(analytics_grid_capacity > 0){
+		free_neighbour_grid(&analytics_grid);
+		analytics_grid_capacity = 0;
+	}
+}
@@ -0,0 +1,47 @@
+#ifndef ANALYTICS_H
+#define ANALYTICS_H
+
+
+/* IN-SITU ANALYTICS:
+ *	Every analytics_interval steps the head node sets
+ *	CONTINUE_ANALYTICS, and every node of the simulation adds up
+ *	statistics of what it holds into a partial result of fixed size:
+ *		organism nodes: a density histogram of their organisms
+ *			(ANALYTICS_GRID x ANALYTICS_GRID cells over the world) and
+ *			the sums of x, y, x*x and y*y, per species
+ *		collision nodes: for every task, a histogram of the distance
+ *			from each prey to its nearest predator (ANALYTICS_BINS bins
+ *			of ANALYTICS_BIN_WIDTH pixels, then one for anything farther)
+ *	One MPI_Ireduce (a sum over sim_comm) combines them on the head
+ *	node, which works out clustering measures from the histograms (the
+ *	variance to mean ratio and Morisita's index of the cell counts) and
+ *	writes it all to analytics_path as text. So what is sent does not
+ *	grow with the populations, and no position leaves its node.
+ *	Nodes do not wait for a reduction to finish until they start the
+ *	next one (or stop); the head writes each one out then.
+ *	The local engine adds up everything on the head node itself.
+ */
+
+#define ANALYTICS_GRID 16
+#define ANALYTICS_CELLS (ANALYTICS_GRID * ANALYTICS_GRID)
+#define ANALYTICS_BINS 16
+#define ANALYTICS_BIN_WIDTH 8
+
+// analyse every analytics_interval steps (0 = never, the default)
+int analytics_interval;
+
+// file the head node writes the analyses to (NULL = envsim.analytics)
+char *analytics_path;
+
+
+/* Analytics methods */
+void init_analytics();
+void analytics_begin();
+void analytics_species(int type, int positions[], int count);
+void analytics_interaction(int task, int prey[], int num_prey,
+	int predators[], int num_predators);
+void analytics_reduce(int step);
+void analytics_finish();
+
+
+#endif
@@ -0,0 +1,266 @@
+#include "checkpoint.h"
+
+#include <string.h>
+
+
+// starting population of each organism (fixes the size of every slot)
+int checkpoint_counts[NUMBER_OF_ORGANISMS];
+
+// where this node's slot starts in the file, how big it is, and how
+//	big the whole file is
+MPI_Offset slot_offset;
+int slot_size;
+MPI_Offset checkpoint_total;
+
+// checkpoint being written (to checkpoint_temp_path), staging buffer,
+//	and the write in flight (if any)
+MPI_File checkpoint_file;
+int checkpoint_open = 0;
+char *checkpoint_temp_path;
+char *staging;
+MPI_Request checkpoint_request;
+int checkpoint_pending = 0;
+
+
+/* Size in bytes of the given node's slot in the checkpoint file:
+ *	HEAD NODE: file header
+ *	ORGANISM NODES: counters, then positions, x and y velocities and
+ *		total feeds for up to the starting population of the type
+ *		(any shard may grow to hold all of it after rebalancing)
+ *	COLLISION NODES: organisms per shard of every species used, then
+ *		the death and feed reports of every task that will be sent at
+ *		the start of the next step
+ *	UNUSED NODES: nothing
+ */
+int checkpoint_slot_size(int node){
+	int type = 0;
+	int role = layout_node(node, &type, NULL);
+	if(role == ROLE_HEAD){
+		return CHECKPOINT_HEADER_SIZE;
+	}
+	else if(role == ROLE_ORGANISM){
+		int count = checkpoint_counts[type];
+		return (6 + 5*count) * sizeof(int);
+	}
+	else if(role == ROLE_COLLISION){
+		int size = 0;
+		int i;
+		for(i=0; i<num_species; i++){
+			if(node_uses_species(node, i))
+				size += num_shards[i] * sizeof(int);
+		}
+		for(i=0; i<num_interactions; i++){
+			if(interactions[i].node == node){
+				size += checkpoint_counts[interactions[i].prey] * sizeof(char)
+					+ checkpoint_counts[interactions[i].predator] * sizeof(int);
+			}
+		}
+		return size;
+	}
+	return 0;
+}
+
+
+/* Reads the header and this node's slot from the restart file. Every
+ *	node reads (and checks) the header, so a mismatched file stops
+ *	all of them.
+ */
+void read_restart(){
+	MPI_File file;
+	if(MPI_File_open(sim_comm, restart_path, MPI_MODE_RDONLY,
+			MPI_INFO_NULL, &file) != MPI_SUCCESS){
+		if(rank == 0)
+			printf("Error: could not open restart file %s\n", restart_path);
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	char header[CHECKPOINT_HEADER_SIZE];
+	MPI_File_read_at_all(file, 0, header, CHECKPOINT_HEADER_SIZE,
+		MPI_BYTE, &status);
+
+	// header: magic, version, number of nodes, step, number of species
+	//	and interactions, starting populations, shards per organism
+	//	type, then the size of the whole file
+	int values[5 + 2*NUMBER_OF_ORGANISMS];
+	char *cursor = unpack_ints(&header[8], values, 5 + 2*NUMBER_OF_ORGANISMS);
+	MPI_Offset recorded_size, file_size;
+	memcpy(&recorded_size, cursor, sizeof(MPI_Offset));
+	MPI_File_get_size(file, &file_size);
+	int valid = (memcmp(header, CHECKPOINT_MAGIC, 8) == 0)
+		&& values[0] == CHECKPOINT_VERSION
+		&& values[1] == num_processors
+		&& values[3] == num_species
+		&& values[4] == num_interactions;
+	if(valid && (recorded_size != checkpoint_total || file_size != checkpoint_total)){
+		if(rank == 0){
+			printf("Error: %s is %lld bytes, but should be %lld (cut short?)\n",
+				restart_path, (long long)file_size, (long long)checkpoint_total);
+		}
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+	int i;
+	for(i=0; i<NUMBER_OF_ORGANISMS; i++){
+		if(values[5+i] != checkpoint_counts[i] ||
+				values[5+NUMBER_OF_ORGANISMS+i] != num_shards[i])
+			valid = 0;
+	}
+	if(!valid){
+		if(rank == 0){
+			printf("Error: %s does not match this run ", restart_path);
+			printf("(same number of nodes, food web, organisms and shards ");
+			printf("required).\n");
+		}
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	restart_slot = (char*)(malloc(slot_size > 0 ? slot_size : 1));
+	MPI_File_read_at_all(file, slot_offset, restart_slot, slot_size,
+		MPI_BYTE, &status);
+	MPI_File_close(&file);
+
+	// the first report after a restart is the one after the checkpoint
+	if(rank == 0){
+		sim_step = values[2] + substeps;
+		printf("Restarting from %s at step %d.\n", restart_path, sim_step);
+	}
+}
+
+
+/* ALL NODES: compute this node's slot, read the restart file (if
+ *	restarting), and open the checkpoint file (if checkpointing).
+ *	Must be called by every node, before populations change.
+ */
+void init_checkpoint(){
+	int i;
+	for(i=0; i<NUMBER_OF_ORGANISMS; i++){
+		checkpoint_counts[i] = (i < num_species) ? species[i].count : 0;
+	}
+
+	slot_offset = 0;
+	checkpoint_total = 0;
+	for(i=0; i<num_processors; i++){
+		if(i == rank)
+			slot_offset = checkpoint_total;
+		checkpoint_total += checkpoint_slot_size(i);
+	}
+	slot_size = checkpoint_slot_size(rank);
+
+	restart_slot = NULL;
+	if(restart_path != NULL)
+		read_restart();
+
+	if(checkpoint_interval <= 0)
+		return;
+
+	if(checkpoint_path == NULL)
+		checkpoint_path = "envsim.ckpt";
+	staging = (char*)(malloc(slot_size > 0 ? slot_size : 1));
+	checkpoint_temp_path = (char*)(malloc(strlen(checkpoint_path) + 5));
+	sprintf(checkpoint_temp_path, "%s.tmp", checkpoint_path);
+}
+
+
+/* ALL NODES: close the checkpoint just written, and (once every node
+ *	has) let it replace the last one.
+ */
+void checkpoint_close(){
+	if(!checkpoint_open)
+		return;
+	if(checkpoint_pending){
+		MPI_Wait(&checkpoint_request, &status);
+		checkpoint_pending = 0;
+	}
+	MPI_File_close(&checkpoint_file);
+	checkpoint_open = 0;
+	MPI_Barrier(sim_comm);
+	if(rank == 0 && rename(checkpoint_temp_path, checkpoint_path) != 0)
+		printf("Error: could not replace checkpoint %s\n", checkpoint_path);
+}
+
+
+/* Returns the staging buffer to copy this node's state into. Waits
+ *	for the previous checkpoint write first, if it is still going.
+ *	The head node's header is filled in here.
+ */
+char *checkpoint_stage(){
+	checkpoint_close();
+
+	if(rank == 0){
+		memset(staging, 0, CHECKPOINT_HEADER_SIZE);
+		memcpy(staging, CHECKPOINT_MAGIC, 8);
+		int values[5 + 2*NUMBER_OF_ORGANISMS];
+		values[0] = CHECKPOINT_VERSION;
+		values[1] = num_processors;
+		values[2] = sim_step;
+		values[3] = num_species;
+		values[4] = num_interactions;
+		memcpy(&values[5], checkpoint_counts, sizeof(checkpoint_counts));
+		memcpy(&values[5+NUMBER_OF_ORGANISMS], num_shards, sizeof(num_shards));
+		char *cursor = pack_ints(&staging[8], values, 5 + 2*NUMBER_OF_ORGANISMS);
+		memcpy(cursor, &checkpoint_total, sizeof(MPI_Offset));
+		printf("Writing checkpoint at step %d to %s\n", sim_step, checkpoint_path);
+	}
+	return staging;
+}
+
+
+/* Opens a new temporary checkpoint file (collective), and starts the
+ *	collective write of the staged slot into it. Returns right away;
+ *	the write completes in the background.
+ */
+void checkpoint_write(){
+	if(MPI_File_open(sim_comm, checkpoint_temp_path,
+			MPI_MODE_CREATE | MPI_MODE_WRONLY,
+			MPI_INFO_NULL, &checkpoint_file) != MPI_SUCCESS){
+		if(rank == 0)
+			printf("Error: could not open checkpoint file %s\n",
+				checkpoint_temp_path);
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+	MPI_File_set_size(checkpoint_file, checkpoint_total);
+	checkpoint_open = 1;
+	MPI_File_iwrite_at_all(checkpoint_file, slot_offset, staging, slot_size,
+		MPI_BYTE, &checkpoint_request);
+	checkpoint_pending = 1;
+}
+
+
+/* Lets a checkpoint write in flight make progress (call once a step) */
+void checkpoint_progress(){
+	if(checkpoint_pending){
+		int done;
+		MPI_Test(&checkpoint_request, &done, &status);
+		if(done)
+			checkpoint_pending = 0;
+	}
+}
+
+
+/* ALL NODES: finish the last write and put it in place (collective,
+ *	so every node calls this when it is done).
+ */
+void checkpoint_finish(){
+	checkpoint_close();
+}
+
+
+/* PACKING: copy values in or out of a slot at the cursor */
+char *pack_ints(char *cursor, int values[], int count){
+	memcpy(cursor, values, count * sizeof(int));
+	return cursor + count * sizeof(int);
+}
+
+char *unpack_ints(char *cursor, int values[], int count){
+	memcpy(values, cursor, count * sizeof(int));
+	return cursor + count * sizeof(int);
+}
+
+char *pack_chars(char *cursor, char values[], int count){
+	memcpy(cursor, values, count * sizeof(char));
+	return cursor + count * sizeof(char);
+}
+
+char *unpack_chars(char *cursor, char values[], int count){
+	memcpy(values, cursor, count * sizeof(char));
+	return cursor + count * sizeof(char);
+}
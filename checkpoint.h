@@ -0,0 +1,58 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+
+/* Contains functions for global operations */
+#include "global.h"
+
+
+/* CHECKPOINT / RESTART:
+ *	Every checkpoint_interval steps the head node sets the
+ *	CONTINUE_CHECKPOINT flag in its continue message. Every node then
+ *	copies its state into a staging buffer and starts a nonblocking
+ *	collective write of it into one shared file with MPI-IO, so the
+ *	simulation loop keeps going while the data is written.
+ *
+ *	File layout (all slot sizes are fixed by the starting populations
+ *	and the shard layout, so every node can compute every offset on
+ *	its own):
+ *		[header (head node)][slot of node 1][slot of node 2]...
+ *	Each checkpoint is written to <file>.tmp, which replaces the file
+ *	only once every node has written and closed it (when the next
+ *	checkpoint starts, or at the end). So a crash during a write leaves
+ *	the previous checkpoint in place. The header holds the size of the
+ *	whole file, which a restart checks against the file it reads.
+ */
+
+#define CHECKPOINT_HEADER_SIZE 256
+#define CHECKPOINT_MAGIC "ENVSIMCK"
+#define CHECKPOINT_VERSION 4
+
+
+// write a checkpoint every checkpoint_interval steps (0 = off)
+int checkpoint_interval;
+
+// file written to (defaults to "envsim.ckpt"), and file to restart from
+char *checkpoint_path;
+char *restart_path;
+
+// this node's state from the restart file (NULL if not restarting)
+char *restart_slot;
+
+
+/* Checkpoint methods */
+void init_checkpoint();
+int checkpoint_slot_size(int node);
+char *checkpoint_stage();
+void checkpoint_write();
+void checkpoint_progress();
+void checkpoint_finish();
+
+/* pack / unpack values into a slot, returning the cursor after them */
+char *pack_ints(char *cursor, int values[], int count);
+char *unpack_ints(char *cursor, int values[], int count);
+char *pack_chars(char *cursor, char values[], int count);
+char *unpack_chars(char *cursor, char values[], int count);
+
+
+#endif
@@ -0,0 +1,936 @@
+#include "collision.h"
+
+#include <string.h>
+
+
+/* Checks every prey against every predator. The first predator (in
+ *	order) that reaches a prey eats it.
+ *	COLLIDE_BRUTE makes one instance of the loop for a given radius:
+ *	the common radii get their own, with the radius folded into the
+ *	comparisons, and collide_brute picks one.
+ */
+#define COLLIDE_BRUTE(name, RADIUS) \
+void name(int prey_positions[], int num_prey, \
+		int predator_positions[], int num_predators, int radius, \
+		char deaths[], int feeds[]){ \
+	int i; /* index variable */ \
+	int j; /* index variable */ \
+	for(i=0; i<num_prey; i++){ \
+		int preyX = prey_positions[i*2]; \
+		int preyY = prey_positions[i*2+1]; \
+		if(deaths[i]) \
+			continue; \
+		for(j=0; j<num_predators; j++){ \
+			int predX = predator_positions[j*2]; \
+			int predY = predator_positions[j*2+1]; \
+			/* first predator in reach eats the prey */ \
+			if(	preyX <= predX+(RADIUS) && preyX >= predX-(RADIUS) && \
+				preyY <= predY+(RADIUS) && preyY >= predY-(RADIUS)){ \
+					deaths[i] = 1; \
+					feeds[j]++; \
+					break; \
+			} \
+		} \
+	} \
+}
+
+COLLIDE_BRUTE(collide_brute_radius1, 1)
+COLLIDE_BRUTE(collide_brute_radius2, 2)
+COLLIDE_BRUTE(collide_brute_any, radius)
+
+void collide_brute(int prey_positions[], int num_prey,
+		int predator_positions[], int num_predators, int radius,
+		char deaths[], int feeds[]){
+	switch(radius){
+		case 1:
+			collide_brute_radius1(prey_positions, num_prey, predator_positions,
+				num_predators, radius, deaths, feeds);
+			break;
+		case 2:
+			collide_brute_radius2(prey_positions, num_prey, predator_positions,
+				num_predators, radius, deaths, feeds);
+			break;
+		default:
+			collide_brute_any(prey_positions, num_prey, predator_positions,
+				num_predators, radius, deaths, feeds);
+	}
+}
+
+
+/* Same as collide_brute for prey [first, last), with the predators
+ *	already in a grid (cells at least radius wide): each prey only
+ *	looks at the cells within reach, and keeps the lowest predator
+ *	index found. COLLIDE_GRID makes one instance per radius, as
+ *	COLLIDE_BRUTE does.
+ */
+#define COLLIDE_GRID(name, RADIUS) \
+void name(NeighbourGrid *grid, int prey[], int predators[], int radius, \
+		int first, int last, char deaths[], int feeds[]){ \
+	int i; \
+	for(i=first; i<last; i++){ \
+		int x = prey[2*i]; \
+		int y = prey[2*i+1]; \
+		int first_cell, last_cell; \
+		neighbour_range(grid, x, y, (RADIUS), &first_cell, &last_cell); \
+		int first_column = first_cell % grid->width; \
+		int last_column = last_cell % grid->width; \
+		int eater = -1; \
+		int row, n; \
+		for(row = first_cell / grid->width; row <= last_cell / grid->width; row++){ \
+			int start = grid->cell_start[row * grid->width + first_column]; \
+			int end = grid->cell_start[row * grid->width + last_column + 1]; \
+			for(n=start; n<end; n++){ \
+				int j = grid->indices[n]; \
+				if(eater >= 0 && j > eater) \
+					continue; \
+				int dx = predators[2*j] - x; \
+				int dy = predators[2*j+1] - y; \
+				if(dx >= -(RADIUS) && dx <= (RADIUS) && \
+						dy >= -(RADIUS) && dy <= (RADIUS)) \
+					eater = j; \
+			} \
+		} \
+		if(eater >= 0){ \
+			deaths[i] = 1; \
+			feeds[eater]++; \
+		} \
+	} \
+}
+
+COLLIDE_GRID(collide_grid_radius1, 1)
+COLLIDE_GRID(collide_grid_radius2, 2)
+COLLIDE_GRID(collide_grid_any, radius)
+
+void collide_grid(NeighbourGrid *grid, int prey[], int predators[],
+		int radius, int first, int last, char deaths[], int feeds[]){
+	switch(radius){
+		case 1:
+			collide_grid_radius1(grid, prey, predators, radius,
+				first, last, deaths, feeds);
+			break;
+		case 2:
+			collide_grid_radius2(grid, prey, predators, radius,
+				first, last, deaths, feeds);
+			break;
+		default:
+			collide_grid_any(grid, prey, predators, radius,
+				first, last, deaths, feeds);
+	}
+}
+
+
+/* Same as collide_brute, with the predators sorted along x (a
+ *	counting sort into one bin per pixel column, in the tuner's
+ *	sweep_start and sweep_order): each prey sweeps over the predators
+ *	of the columns within reach only, and keeps the lowest index found.
+ */
+void collide_sweep(CollisionTuner *tuner, int prey[], int num_prey,
+		int predators[], int num_predators, int radius,
+		char deaths[], int feeds[]){
+	int *start = tuner->sweep_start;
+	int *order = tuner->sweep_order;
+	int columns = world_width + 1;
+	int i, j;
+
+	// sort the predators by column (points outside the world go in
+	//	the edge columns)
+	memset(start, 0, (columns + 1) * sizeof(int));
+	for(i=0; i<num_predators; i++){
+		int column = predators[2*i];
+		column = (column < 0) ? 0 : (column >= columns) ? columns - 1 : column;
+		start[column + 1]++;
+	}
+	for(i=0; i<columns; i++){
+		start[i+1] += start[i];
+	}
+	memcpy(tuner->sweep_fill, start, columns * sizeof(int));
+	for(i=0; i<num_predators; i++){
+		int column = predators[2*i];
+		column = (column < 0) ? 0 : (column >= columns) ? columns - 1 : column;
+		order[tuner->sweep_fill[column]++] = i;
+	}
+
+	for(i=0; i<num_prey; i++){
+		int x = prey[2*i];
+		int y = prey[2*i+1];
+		int first = x - radius;
+		int last = x + radius;
+		first = (first < 0) ? 0 : (first >= columns) ? columns - 1 : first;
+		last = (last < 0) ? 0 : (last >= columns) ? columns - 1 : last;
+		int eater = -1;
+		int n;
+		for(n=start[first]; n<start[last+1]; n++){
+			j = order[n];
+			if(eater >= 0 && j > eater)
+				continue;
+			int dx = predators[2*j] - x;
+			int dy = predators[2*j+1] - y;
+			if(dx >= -radius && dx <= radius && dy >= -radius && dy <= radius)
+				eater = j;
+		}
+		if(eater >= 0){
+			deaths[i] = 1;
+			feeds[eater]++;
+		}
+	}
+}
+
+
+/* AUTOTUNER: set up one task's kernels (for up to the given prey and
+ *	predators).
+ */
+void init_tuner(CollisionTuner *tuner, int radius, int max_prey,
+		int max_predators){
+	memset(tuner, 0, sizeof(CollisionTuner));
+	tuner->kernel = KERNEL_BRUTE;
+	tuner->tuned_prey = -1; // not tuned yet
+	init_neighbour_grid(&tuner->grid, radius > 1 ? radius : 1, max_predators);
+	tuner->sweep_start = (int*)(malloc((world_width + 2) * sizeof(int)));
+	tuner->sweep_fill = (int*)(malloc((world_width + 1) * sizeof(int)));
+	tuner->sweep_order = (int*)(malloc((max_predators + 1) * sizeof(int)));
+	tuner->trial_deaths = (char*)(malloc(max_prey + 1));
+	tuner->trial_feeds = (int*)(malloc((max_predators + 1) * sizeof(int)));
+}
+
+void free_tuner(CollisionTuner *tuner){
+	free_neighbour_grid(&tuner->grid);
+	free(tuner->sweep_start);
+	free(tuner->sweep_fill);
+	free(tuner->sweep_order);
+	free(tuner->trial_deaths);
+	free(tuner->trial_feeds);
+}
+
+
+/* Runs the given kernel on one exchange's positions */
+void run_tuner_kernel(CollisionTuner *tuner, int kernel,
+		int prey[], int num_prey, int predators[], int num_predators, int radius,
+		char deaths[], int feeds[]){
+	if(kernel == KERNEL_GRID){
+		build_neighbour_grid(&tuner->grid, predators, num_predators);
+		collide_grid(&tuner->grid, prey, predators, radius, 0, num_prey,
+			deaths, feeds);
+	}
+	else if(kernel == KERNEL_SWEEP){
+		collide_sweep(tuner, prey, num_prey, predators, num_predators, radius,
+			deaths, feeds);
+	}
+	else{
+		collide_brute(prey, num_prey, predators, num_predators, radius,
+			deaths, feeds);
+	}
+}
+
+
+/* Whether a population has grown or shrunk by AUTOTUNE_RATIO since the
+ *	last tuning.
+ */
+int population_swung(int now, int tuned){
+	return (now + 1) > (tuned + 1) * AUTOTUNE_RATIO ||
+		(now + 1) * AUTOTUNE_RATIO < (tuned + 1);
+}
+
+
+/* Same as collide_brute (deaths and feeds cleared), with the tuned
+ *	kernel. On the first exchange, and whenever the prey or predators
+ *	have swung since the last tuning, every kernel is timed on this
+ *	exchange (all give the same reports; the grid's are kept) and the
+ *	fastest is used until the next tuning. Brute force only checks the
+ *	first AUTOTUNE_SAMPLE prey, and its time is scaled up to all of
+ *	them (it takes as long for every prey).
+ */
+void collide_tuned(CollisionTuner *tuner, int prey[], int num_prey,
+		int predators[], int num_predators, int radius,
+		char deaths[], int feeds[]){
+	int kernel;
+	double start;
+	if(tuner->tuned_prey < 0 ||
+			population_swung(num_prey, tuner->tuned_prey) ||
+			population_swung(num_predators, tuner->tuned_predators)){
+		tuner->kernel = KERNEL_GRID;
+		for(kernel=0; kernel<NUM_KERNELS; kernel++){
+			char *trial_deaths = deaths;
+			int *trial_feeds = feeds;
+			int trial_prey = num_prey;
+			if(kernel != KERNEL_GRID){
+				trial_deaths = tuner->trial_deaths;
+				trial_feeds = tuner->trial_feeds;
+				memset(trial_deaths, 0, num_prey * sizeof(char));
+				memset(trial_feeds, 0, num_predators * sizeof(int));
+			}
+			if(kernel == KERNEL_BRUTE && trial_prey > AUTOTUNE_SAMPLE)
+				trial_prey = AUTOTUNE_SAMPLE;
+			start = MPI_Wtime();
+			run_tuner_kernel(tuner, kernel, prey, trial_prey, predators,
+				num_predators, radius, trial_deaths, trial_feeds);
+			tuner->trial_seconds[kernel] = MPI_Wtime() - start;
+			if(trial_prey > 0)
+				tuner->trial_seconds[kernel] *= (double)num_prey / trial_prey;
+		}
+		for(kernel=0; kernel<NUM_KERNELS; kernel++){
+			if(tuner->trial_seconds[kernel] < tuner->trial_seconds[tuner->kernel])
+				tuner->kernel = kernel;
+		}
+		tuner->tuned_prey = num_prey;
+		tuner->tuned_predators = num_predators;
+		tuner->tunings++;
+		tuner->seconds[KERNEL_GRID] += tuner->trial_seconds[KERNEL_GRID];
+		tuner->exchanges[KERNEL_GRID]++;
+		return;
+	}
+
+	kernel = tuner->kernel;
+	start = MPI_Wtime();
+	run_tuner_kernel(tuner, kernel, prey, num_prey, predators, num_predators,
+		radius, deaths, feeds);
+	tuner->seconds[kernel] += MPI_Wtime() - start;
+	tuner->exchanges[kernel]++;
+}
+
+
+/* Prints the kernel of a task, how often it was tuned, the timings of
+ *	the last tuning, and the time spent in each kernel (one printf).
+ */
+void report_tuner(CollisionTuner *tuner, int task){
+	const char *names[NUM_KERNELS] = { "brute", "grid", "sweep" };
+	Interaction *interaction = &interactions[task];
+	char text[512];
+	int length = sprintf(text, "(%d) #### %s eat %s: %s kernel (tuned %d times)\n",
+		rank, species[interaction->predator].name,
+		species[interaction->prey].name, names[tuner->kernel], tuner->tunings);
+	length += sprintf(&text[length], "(%d) ####   last tuning:", rank);
+	int kernel;
+	for(kernel=0; kernel<NUM_KERNELS; kernel++){
+		length += sprintf(&text[length], " %s %.6f s", names[kernel],
+			tuner->trial_seconds[kernel]);
+	}
+	length += sprintf(&text[length], "\n(%d) ####   ran:", rank);
+	for(kernel=0; kernel<NUM_KERNELS; kernel++){
+		length += sprintf(&text[length], " %s %d exchanges %.3f s", names[kernel],
+			tuner->exchanges[kernel], tuner->seconds[kernel]);
+	}
+	printf("%s\n", text);
+}
+
+
+/* Replays the given number of steps from the starting states (stride
+ *	4), or copies the positions of organisms that do not move (stride
+ *	2), and computes the bounding box of every path.
+ */
+void expand_paths(Paths *paths, int data[], int stride, int count, int steps){
+	int length = paths->length;
+	int i, k;
+	for(i=0; i<count; i++){
+		int x = data[i*stride];
+		int y = data[i*stride+1];
+		int *point = &paths->points[i*length*2];
+		int *box = &paths->boxes[i*4];
+		point[0] = box[0] = box[2] = x;
+		point[1] = box[1] = box[3] = y;
+		if(length == 1)
+			continue;
+
+		int x_velocity = data[i*stride+2];
+		int y_velocity = data[i*stride+3];
+		for(k=1; k<=steps; k++){
+			step_organism(&x, &y, &x_velocity, &y_velocity);
+			point[2*k] = x;
+			point[2*k+1] = y;
+			if(x < box[0])
+				box[0] = x;
+			if(y < box[1])
+				box[1] = y;
+			if(x > box[2])
+				box[2] = x;
+			if(y > box[3])
+				box[3] = y;
+		}
+	}
+}
+
+
+/* Whether a prey moving in a straight line from prey_from to prey_to
+ *	comes within radius (along both axes) of a predator moving from
+ *	predator_from to predator_to during the same step.
+ *	Solved along each axis for the part of the step the two are close,
+ *	then checked for overlap.
+ */
+int swept_hit(int prey_from[], int prey_to[],
+		int predator_from[], int predator_to[], int radius){
+	double enter = 0.0;
+	double leave = 1.0;
+	int axis;
+	for(axis=0; axis<2; axis++){
+		int start = prey_from[axis] - predator_from[axis];
+		int change = (prey_to[axis] - predator_to[axis]) - start;
+		if(change == 0){
+			if(start < -radius || start > radius)
+				return 0;
+			continue;
+		}
+		double t1 = (double)(-radius - start) / change;
+		double t2 = (double)(radius - start) / change;
+		if(t1 > t2){
+			double swap = t1;
+			t1 = t2;
+			t2 = swap;
+		}
+		if(t1 > enter)
+			enter = t1;
+		if(t2 < leave)
+			leave = t2;
+		if(enter > leave)
+			return 0;
+	}
+	return 1;
+}
+
+
+/* Checks every prey path against every predator path. Bounding boxes
+ *	(grown by the radius) rule out most pairs; the rest are checked
+ *	step by step with swept segments. The first predator (in order)
+ *	that reaches a prey eats it.
+ */
+void collide_swept(Paths *prey, int num_prey,
+		Paths *predators, int num_predators, int steps,
+		int radius, char deaths[], int feeds[]){
+	int prey_last = prey->length - 1;
+	int predator_last = predators->length - 1;
+	int i; // index variable
+	int j; // index variable
+	int k; // step variable
+	for(i=0; i<num_prey; i++){
+		int *prey_box = &prey->boxes[i*4];
+		int *prey_path = &prey->points[i*prey->length*2];
+		for(j=0; j<num_predators && deaths[i] == 0; j++){
+			int *predator_box = &predators->boxes[j*4];
+
+			// paths never come close
+			if(	prey_box[0] > predator_box[2]+radius ||
+				prey_box[2] < predator_box[0]-radius ||
+				prey_box[1] > predator_box[3]+radius ||
+				prey_box[3] < predator_box[1]-radius){
+					continue;
+			}
+
+			int *predator_path = &predators->points[j*predators->length*2];
+			for(k=0; k<steps; k++){
+				int *prey_from = &prey_path[2*(k < prey_last ? k : prey_last)];
+				int *prey_to = &prey_path[2*(k+1 < prey_last ? k+1 : prey_last)];
+				int *predator_from =
+					&predator_path[2*(k < predator_last ? k : predator_last)];
+				int *predator_to =
+					&predator_path[2*(k+1 < predator_last ? k+1 : predator_last)];
+				if(swept_hit(prey_from, prey_to,
+						predator_from, predator_to, radius)){
+					deaths[i] = 1;
+					feeds[j]++;
+					break;
+				}
+			}
+		}
+	}
+}
+
+
+/* FUSED ENGINE: set up the grid and claim buffers for the given tasks
+ *	(cells as big as the largest radius).
+ */
+void init_fused_engine(FusedEngine *engine, int tasks[], int num_tasks){
+	int capacity = 0;
+	int cell_size = 1;
+	int a, b, k;
+	for(a=0; a<NUMBER_OF_ORGANISMS; a++){
+		engine->reach[a] = -1;
+		engine->first[a] = 0;
+		engine->count[a] = 0;
+		for(b=0; b<NUMBER_OF_ORGANISMS; b++){
+			engine->task_of[a][b] = -1;
+		}
+	}
+	engine->num_tasks = num_tasks;
+	engine->tasks = tasks;
+	engine->claims = (int**)(malloc((num_tasks + 1) * sizeof(int*)));
+	for(k=0; k<num_tasks; k++){
+		Interaction *task = &interactions[tasks[k]];
+		engine->task_of[task->predator][task->prey] = k;
+		if(task->radius > engine->reach[task->predator])
+			engine->reach[task->predator] = task->radius;
+		if(task->radius > cell_size)
+			cell_size = task->radius;
+		engine->claims[k] = (int*)(malloc(
+			(num_organisms_of(task->prey) + 1) * sizeof(int)));
+	}
+	for(a=0; a<num_species; a++){
+		if(node_uses_species(rank, a))
+			capacity += num_organisms_of(a);
+	}
+	engine->points = (int*)(malloc((capacity + 1) * 2 * sizeof(int)));
+	engine->owners = (char*)(malloc(capacity + 1));
+	engine->total = 0;
+	init_neighbour_grid(&engine->grid, cell_size, capacity);
+}
+
+void free_fused_engine(FusedEngine *engine){
+	int k;
+	for(k=0; k<engine->num_tasks; k++){
+		free(engine->claims[k]);
+	}
+	free(engine->claims);
+	free(engine->points);
+	free(engine->owners);
+	free_neighbour_grid(&engine->grid);
+}
+
+
+/* Where the positions of the given species go next (right after the
+ *	species received before it; total is reset every exchange), and
+ *	how many were received there.
+ */
+int *fused_species_points(FusedEngine *engine, int type){
+	engine->first[type] = engine->total;
+	return &engine->points[2 * engine->total];
+}
+
+void fused_species_received(FusedEngine *engine, int type, int count){
+	engine->count[type] = count;
+	memset(&engine->owners[engine->first[type]], type, count);
+	engine->total += count;
+}
+
+
+/* Checks the prey of every task against its predators with one grid
+ *	over all species: every organism that hunts looks at the cells
+ *	within its largest radius once, and claims the prey of each of its
+ *	tasks in range. Predators are visited in order, so the first
+ *	predator (in order) that reaches a prey eats it, as in
+ *	collide_brute.
+ */
+void collide_fused(FusedEngine *engine, char *deaths[], int *feeds[]){
+	NeighbourGrid *grid = &engine->grid;
+	build_neighbour_grid(grid, engine->points, engine->total);
+
+	int k, i, p;
+	for(k=0; k<engine->num_tasks; k++){
+		Interaction *task = &interactions[engine->tasks[k]];
+		for(i=0; i<engine->count[task->prey]; i++){
+			engine->claims[k][i] = -1;
+		}
+	}
+
+	for(p=0; p<engine->total; p++){
+		int type = engine->owners[p];
+		int reach = engine->reach[type];
+		if(reach < 0)
+			continue;
+		int x = engine->points[2*p];
+		int y = engine->points[2*p+1];
+		int predator = p - engine->first[type];
+
+		int first_cell, last_cell;
+		neighbour_range(grid, x, y, reach, &first_cell, &last_cell);
+		int first_column = first_cell % grid->width;
+		int last_column = last_cell % grid->width;
+		int row;
+		for(row = first_cell / grid->width; row <= last_cell / grid->width; row++){
+			int start = grid->cell_start[row * grid->width + first_column];
+			int end = grid->cell_start[row * grid->width + last_column + 1];
+			for(i=start; i<end; i++){
+				int q = grid->indices[i];
+				int prey_type = engine->owners[q];
+				k = engine->task_of[type][prey_type];
+				if(k < 0)
+					continue;
+				int radius = interactions[engine->tasks[k]].radius;
+				int dx = engine->points[2*q] - x;
+				int dy = engine->points[2*q+1] - y;
+				if(dx < -radius || dx > radius || dy < -radius || dy > radius)
+					continue;
+				int prey = q - engine->first[prey_type];
+				if(engine->claims[k][prey] < 0)
+					engine->claims[k][prey] = predator;
+			}
+		}
+	}
+
+	// the first predator to reach each prey eats it
+	for(k=0; k<engine->num_tasks; k++){
+		Interaction *task = &interactions[engine->tasks[k]];
+		for(i=0; i<engine->count[task->prey]; i++){
+			if(engine->claims[k][i] >= 0){
+				deaths[k][i] = 1;
+				feeds[k][engine->claims[k][i]]++;
+			}
+		}
+	}
+}
+
+
+/* FUSED: the combined report of count organisms of the given type
+ *	(from offset on): deaths from every task it is the prey of, then
+ *	feeds summed over every task it is the predator of.
+ */
+void combine_reports(int type, int offset, int count, int tasks[],
+		int num_tasks, char *deaths[], int *feeds[], char combined[]){
+	int k, i;
+	for(i=0; i<count; i++){
+		char dead = 0;
+		int fed = 0;
+		for(k=0; k<num_tasks; k++){
+			Interaction *task = &interactions[tasks[k]];
+			if(task->prey == type)
+				dead |= deaths[k][offset + i];
+			else if(task->predator == type)
+				fed += feeds[k][offset + i];
+		}
+		combined[i] = dead;
+		// (the feeds follow the deaths, so they may not be aligned)
+		memcpy(&combined[count + i * sizeof(int)], &fed, sizeof(int));
+	}
+}
+
+
+/* Values per organism sent to the collision nodes (species that never
+ *	move always send points).
+ */
+int collision_stride(int type){
+	if(substeps > 1 && species[type].speed > 0)
+		return 4;
+	return 2;
+}
+
+
+/* Positions (x, y) of every organism at the end of the exchange: the
+ *	positions received, or the ends of the replayed paths.
+ */
+void end_positions(int data[], int stride, int count,
+		Paths *paths, int positions[]){
+	int i;
+	for(i=0; i<count; i++){
+		if(stride == 2){
+			positions[2*i] = data[2*i];
+			positions[2*i+1] = data[2*i+1];
+		}
+		else{
+			int *last = &paths->points[(i*paths->length + paths->length-1) * 2];
+			positions[2*i] = last[0];
+			positions[2*i+1] = last[1];
+		}
+	}
+}
+
+
+/* COLLISION NODE: run every interaction scheduled on this node (its
+ *	tasks, see schedule_interactions) until the head node stops the
+ *	simulation. Positions of each species are received once, however
+ *	many of the tasks use them.
+ */
+void run_collision_node(){
+	// this node's tasks, in interaction order (the order every organism
+	//	node receives its reports in)
+	int tasks[MAX_INTERACTIONS];
+	int num_tasks = 0;
+	int i, s, t;
+	for(i=0; i<num_interactions; i++){
+		if(interactions[i].node == rank)
+			tasks[num_tasks++] = i;
+	}
+
+	// PER SPECIES used by a task: buffers hold the whole organism type
+	//	(every shard), with the values per organism (positions, or
+	//	starting states)
+	int used[NUMBER_OF_ORGANISMS];
+	int max_count[NUMBER_OF_ORGANISMS];
+	int stride[NUMBER_OF_ORGANISMS];
+	int num_received[NUMBER_OF_ORGANISMS];
+	int *data[NUMBER_OF_ORGANISMS];
+	int *ghosts[NUMBER_OF_ORGANISMS];
+	int num_ghosts[NUMBER_OF_ORGANISMS];
+	Paths paths[NUMBER_OF_ORGANISMS];
+	int sweeping = (substeps > 1);
+
+	// FUSED: one grid over every species (positions go straight into
+	//	it), and one combined report per shard
+	int fusing = fused_collisions && !sweeping;
+	FusedEngine engine;
+	if(fusing)
+		init_fused_engine(&engine, tasks, num_tasks);
+
+	// AUTOTUNING: each task picks its own kernel
+	int tuning = collision_autotune && !sweeping && !fusing;
+	CollisionTuner tuners[MAX_INTERACTIONS];
+	char *combined = NULL;
+	int largest = 0;
+
+	// organisms on each shard (as of the last positions received)
+	int shard_counts[NUMBER_OF_ORGANISMS][MAX_SHARDS];
+
+	// PERCEPTION: positions of a species after the last exchange, sent
+	//	to the other species' organism nodes
+	int keep_ghosts[NUMBER_OF_ORGANISMS];
+	memset(keep_ghosts, 0, sizeof(keep_ghosts));
+	int k;
+	for(k=0; k<num_tasks; k++){
+		if(interaction_ghosts(tasks[k])){
+			keep_ghosts[interactions[tasks[k]].prey] = 1;
+			keep_ghosts[interactions[tasks[k]].predator] = 1;
+		}
+	}
+
+	for(t=0; t<num_species; t++){
+		used[t] = node_uses_species(rank, t);
+		data[t] = NULL;
+		ghosts[t] = NULL;
+		num_ghosts[t] = 0;
+		num_received[t] = 0;
+		if(!used[t])
+			continue;
+		max_count[t] = num_organisms_of(t);
+		stride[t] = collision_stride(t);
+
+		// create initial position buffers (defaults to 0)
+		if(!fusing)
+			data[t] = (int*)(calloc((max_count[t] + 1) * stride[t], sizeof(int)));
+
+		// paths over the steps of an exchange (sub-stepping only)
+		paths[t].length = (stride[t] == 4) ? substeps + 1 : 1;
+		if(sweeping){
+			paths[t].points = (int*)(malloc(
+				(max_count[t] + 1) * paths[t].length * 2 * sizeof(int)));
+			paths[t].boxes = (int*)(malloc(
+				(max_count[t] + 1) * 4 * sizeof(int)));
+		}
+		// (ANALYTICS: also where every species ended up)
+		if(keep_ghosts[t] || analytics_interval > 0)
+			ghosts[t] = (int*)(malloc((max_count[t] + 1) * 2 * sizeof(int)));
+
+		for(s=0; s<num_shards[t]; s++){
+			shard_counts[t][s] = shard_share(max_count[t], s, num_shards[t]);
+		}
+		if(max_count[t] > largest)
+			largest = max_count[t];
+	}
+	if(fused_collisions){
+		combined = (char*)(malloc(
+			(largest + 1) * (sizeof(char) + sizeof(int))));
+	}
+
+	// PER TASK: death buffer (defaults to (char)0 = alive) and feed
+	//	buffer (defaults to 0)
+	char *deaths[MAX_INTERACTIONS];
+	int *feeds[MAX_INTERACTIONS];
+	for(k=0; k<num_tasks; k++){
+		deaths[k] = (char*)(calloc(
+			max_count[interactions[tasks[k]].prey] + 1, sizeof(char)));
+		feeds[k] = (int*)(calloc(
+			max_count[interactions[tasks[k]].predator] + 1, sizeof(int)));
+	}
+
+	for(k=0; tuning && k<num_tasks; k++){
+		Interaction *task = &interactions[tasks[k]];
+		init_tuner(&tuners[k], task->radius, max_count[task->prey],
+			max_count[task->predator]);
+	}
+
+	// restore reports from the restart file
+	if(restart_slot != NULL){
+		char *slot = restart_slot;
+		for(t=0; t<num_species; t++){
+			if(used[t])
+				slot = unpack_ints(slot, shard_counts[t], num_shards[t]);
+		}
+		for(k=0; k<num_tasks; k++){
+			Interaction *task = &interactions[tasks[k]];
+			slot = unpack_chars(slot, deaths[k], max_count[task->prey]);
+			slot = unpack_ints(slot, feeds[k], max_count[task->predator]);
+		}
+	}
+
+	// steps simulated, and prey eaten so far (telemetry)
+	int step = 0;
+	long long eaten = 0;
+
+	// collision processing loop:
+	int message;
+	do{
+		// send feed and death data: each shard gets the part of the
+		//	reports for the organisms it sent (task by task, or FUSED:
+		//	combined, species by species)
+		for(t=0; fused_collisions && t<num_species; t++){
+			if(!used[t])
+				continue;
+			int offset = 0;
+			for(s=0; s<num_shards[t]; s++){
+				combine_reports(t, offset, shard_counts[t][s], tasks, num_tasks,
+					deaths, feeds, combined);
+				MPISendCombinedReport(combined, shard_counts[t][s],
+					shard_nodes[t][s]);
+				offset += shard_counts[t][s];
+			}
+		}
+		for(k=0; !fused_collisions && k<num_tasks; k++){
+			int prey = interactions[tasks[k]].prey;
+			int predator = interactions[tasks[k]].predator;
+			int offset = 0;
+			for(s=0; s<num_shards[prey]; s++){
+				MPISendDeathReports(&deaths[k][offset], shard_counts[prey][s],
+					shard_nodes[prey][s]);
+				offset += shard_counts[prey][s];
+			}
+			offset = 0;
+			for(s=0; s<num_shards[predator]; s++){
+				MPISendFeedReports(&feeds[k][offset], shard_counts[predator][s],
+					shard_nodes[predator][s]);
+				offset += shard_counts[predator][s];
+			}
+		}
+
+		// send every shard the ghosts it steers by
+		for(k=0; k<num_tasks; k++){
+			if(!interaction_ghosts(tasks[k]))
+				continue;
+			int prey = interactions[tasks[k]].prey;
+			int predator = interactions[tasks[k]].predator;
+			for(s=0; s<num_shards[prey]; s++){
+				MPISendGhostPos(ghosts[predator], num_ghosts[predator]*2,
+					shard_nodes[prey][s]);
+			}
+			for(s=0; s<num_shards[predator]; s++){
+				MPISendGhostPos(ghosts[prey], num_ghosts[prey]*2,
+					shard_nodes[predator][s]);
+			}
+		}
+
+		telemetry_phase(PHASE_SEND);
+
+		// receive position data for every species used (in order)
+		//	(FUSED: one after the other into the engine's grid points)
+		int population = 0;
+		if(fusing)
+			engine.total = 0;
+		for(t=0; t<num_species; t++){
+			if(!used[t])
+				continue;
+			if(fusing)
+				data[t] = fused_species_points(&engine, t);
+			num_received[t] = MPIRecvCollisionPos(t, data[t],
+				max_count[t]*stride[t], stride[t], shard_counts[t]);
+			if(fusing)
+				fused_species_received(&engine, t, num_received[t]);
+			population += num_received[t];
+		}
+
+		telemetry_phase(PHASE_RECEIVE);
+
+		// replay the paths of every species once
+		for(t=0; sweeping && t<num_species; t++){
+			if(used[t])
+				expand_paths(&paths[t], data[t], stride[t], num_received[t],
+					substeps);
+		}
+
+		// processes collisions of every task (FUSED: all in one pass)
+		for(k=0; k<num_tasks; k++){
+			int prey = interactions[tasks[k]].prey;
+			int predator = interactions[tasks[k]].predator;
+
+			// clear out the arrays
+			memset(deaths[k], 0, num_received[prey]*sizeof(char));
+			memset(feeds[k], 0, num_received[predator]*sizeof(int));
+		}
+		if(fusing)
+			collide_fused(&engine, deaths, feeds);
+		for(k=0; k<num_tasks; k++){
+			int prey = interactions[tasks[k]].prey;
+			int predator = interactions[tasks[k]].predator;
+			int radius = interactions[tasks[k]].radius;
+
+			if(sweeping){
+				collide_swept(&paths[prey], num_received[prey],
+					&paths[predator], num_received[predator], substeps,
+					radius, deaths[k], feeds[k]);
+			}
+			else if(tuning){
+				collide_tuned(&tuners[k], data[prey], num_received[prey],
+					data[predator], num_received[predator], radius,
+					deaths[k], feeds[k]);
+			}
+			else if(!fusing){
+				collide_brute(data[prey], num_received[prey], data[predator],
+					num_received[predator], radius, deaths[k], feeds[k]);
+			}
+			for(i=0; i<num_received[predator]; i++){
+				eaten += feeds[k][i];
+			}
+		}
+
+		// keep where everything ended up, as the next ghosts
+		for(t=0; t<num_species; t++){
+			if(ghosts[t] == NULL)
+				continue;
+			end_positions(data[t], stride[t], num_received[t],
+				&paths[t], ghosts[t]);
+			num_ghosts[t] = num_received[t];
+		}
+
+		step += substeps;
+		telemetry_phase(PHASE_COLLIDE);
+
+		message = MPIReceiveContinue();
+		telemetry_phase(PHASE_RECEIVE);
+		telemetry_publish(step, population, 0, eaten);
+
+		// nearest predator distances of every task (at the end of the
+		//	exchange)
+		if(message & CONTINUE_ANALYTICS){
+			analytics_begin();
+			for(k=0; k<num_tasks; k++){
+				int prey = interactions[tasks[k]].prey;
+				int predator = interactions[tasks[k]].predator;
+				analytics_interaction(tasks[k], ghosts[prey], num_ghosts[prey],
+					ghosts[predator], num_ghosts[predator]);
+			}
+			analytics_reduce(step);
+		}
+
+		// checkpoint the reports to send next step
+		if(message & CONTINUE_CHECKPOINT){
+			char *slot = checkpoint_stage();
+			for(t=0; t<num_species; t++){
+				if(used[t])
+					slot = pack_ints(slot, shard_counts[t], num_shards[t]);
+			}
+			for(k=0; k<num_tasks; k++){
+				Interaction *task = &interactions[tasks[k]];
+				slot = pack_chars(slot, deaths[k], max_count[task->prey]);
+				slot = pack_ints(slot, feeds[k], max_count[task->predator]);
+			}
+			checkpoint_write();
+		}
+		checkpoint_progress();
+	}
+	while(message);
+
+	for(t=0; t<num_species; t++){
+		if(!used[t])
+			continue;
+		if(sweeping){
+			free(paths[t].points);
+			free(paths[t].boxes);
+		}
+		free(ghosts[t]);
+		if(!fusing)
+			free(data[t]);
+	}
+	for(k=0; k<num_tasks; k++){
+		free(deaths[k]);
+		free(feeds[k]);
+		if(tuning){
+			report_tuner(&tuners[k], tasks[k]);
+			free_tuner(&tuners[k]);
+		}
+	}
+	if(fusing)
+		free_fused_engine(&engine);
+	free(combined);
+}
@@ -0,0 +1,144 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+
+
+/* Contains functions for global operations */
+#include "global.h"
+
+
+/* COLLISION NODES:
+ *	Each collision node checks the prey against the predators of one or
+ *	more interactions of the food web (its tasks, see foodweb.h and
+ *	schedule_interactions). Every exchange it sends each shard of the
+ *	species involved its part of every task's death and feed reports,
+ *	then gathers the new positions from all shards and checks
+ *	collisions. With perception on, tasks between two moving species
+ *	also send each shard the other species' last positions (ghosts, see
+ *	organism.h).
+ */
+
+// collision distance of the built-in web (in pixels, along both axes)
+#define PLANT_HERBIVORE_RADIUS 2
+#define HERBIVORE_PREDATOR_RADIUS 1
+
+
+/* Collision node methods */
+void run_collision_node();
+
+// FUSED COLLISIONS: if set, every interaction runs on one collision
+//	node, which puts all species in one grid, resolves every
+//	interaction in one pass over it, and sends each shard one combined
+//	report (deaths and feeds) instead of one per interaction (when
+//	sub-stepping, the tasks still sweep their paths one by one)
+int fused_collisions;
+
+// values sent per organism of the given type: 2 (x, y), or 4 (x, y,
+//	x velocity, y velocity to start from) when sub-stepping moving
+//	organisms
+int collision_stride(int type);
+
+// SUB-STEPPING: path of each organism over the steps of one exchange
+//	(length points of x, y each), and the bounding box of each path
+//	(min x, min y, max x, max y)
+typedef struct {
+	int length; // 1 for organisms that never move, else steps + 1
+	int *points;
+	int *boxes;
+} Paths;
+
+void expand_paths(Paths *paths, int data[], int stride, int count, int steps);
+void end_positions(int data[], int stride, int count,
+	Paths *paths, int positions[]);
+int swept_hit(int prey_from[], int prey_to[],
+	int predator_from[], int predator_to[], int radius);
+
+// marks every prey within radius of a predator as dead (once), and
+//	counts the prey each predator eats
+void collide_brute(int prey_positions[], int num_prey,
+	int predator_positions[], int num_predators, int radius,
+	char deaths[], int feeds[]);
+
+// same as collide_brute, over the paths of a whole exchange: a prey
+//	dies if it comes within radius of a predator during any step
+void collide_swept(Paths *prey, int num_prey,
+	Paths *predators, int num_predators, int steps,
+	int radius, char deaths[], int feeds[]);
+
+// same as collide_brute for prey [first, last), with the predators in a
+//	grid with cells at least radius wide
+void collide_grid(NeighbourGrid *grid, int prey[], int predators[],
+	int radius, int first, int last, char deaths[], int feeds[]);
+
+
+// COLLISION KERNELS (each task, without sub-stepping or fusing): all
+//	give the same reports, but each is fastest in another regime
+#define KERNEL_BRUTE 0 // every prey against every predator
+#define KERNEL_GRID 1 // predators in a grid, prey look at nearby cells
+#define KERNEL_SWEEP 2 // predators sorted along x, prey sweep nearby columns
+#define NUM_KERNELS 3
+
+// AUTOTUNING: 1 (default) = time every kernel on a task's first
+//	exchange, and again whenever its prey or predators have grown or
+//	shrunk by AUTOTUNE_RATIO since, and use the fastest in between
+//	(timings are reported when the node is done);
+//	0 = always brute force
+int collision_autotune;
+#define AUTOTUNE_RATIO 2
+
+// most prey brute force is timed on (its time is scaled up to all)
+#define AUTOTUNE_SAMPLE 1024
+
+typedef struct {
+	int kernel; // in use
+	int tuned_prey; // populations at the last tuning (-1 = none yet)
+	int tuned_predators;
+	int tunings;
+	double trial_seconds[NUM_KERNELS]; // of every kernel, last tuning
+	double seconds[NUM_KERNELS]; // spent in every kernel in all
+	int exchanges[NUM_KERNELS]; // checked with every kernel
+	NeighbourGrid grid; // (grid kernel)
+	int *sweep_start; // first predator of every column (sweep kernel)
+	int *sweep_fill;
+	int *sweep_order; // predators sorted by column
+	char *trial_deaths; // reports of the kernels timed but not kept
+	int *trial_feeds;
+} CollisionTuner;
+
+void init_tuner(CollisionTuner *tuner, int radius, int max_prey,
+	int max_predators);
+void free_tuner(CollisionTuner *tuner);
+void collide_sweep(CollisionTuner *tuner, int prey[], int num_prey,
+	int predators[], int num_predators, int radius,
+	char deaths[], int feeds[]);
+void collide_tuned(CollisionTuner *tuner, int prey[], int num_prey,
+	int predators[], int num_predators, int radius,
+	char deaths[], int feeds[]);
+void report_tuner(CollisionTuner *tuner, int task);
+
+
+// FUSED ENGINE: one grid over the positions of every species (stored
+//	one species after the other), and what each predator type hunts
+typedef struct {
+	int num_tasks;
+	int *tasks; // (interaction of each task)
+	int task_of[NUMBER_OF_ORGANISMS][NUMBER_OF_ORGANISMS]; // [predator][prey]
+	int reach[NUMBER_OF_ORGANISMS]; // largest radius hunted at (-1 = none)
+	int *points;
+	char *owners; // species of every point
+	int first[NUMBER_OF_ORGANISMS]; // index of every species' first point
+	int count[NUMBER_OF_ORGANISMS];
+	int total;
+	int **claims; // per task: first predator to reach each prey
+	NeighbourGrid grid;
+} FusedEngine;
+
+void init_fused_engine(FusedEngine *engine, int tasks[], int num_tasks);
+void free_fused_engine(FusedEngine *engine);
+int *fused_species_points(FusedEngine *engine, int type);
+void fused_species_received(FusedEngine *engine, int type, int count);
+
+// same as collide_brute for every task, in one pass over the grid
+void collide_fused(FusedEngine *engine, char *deaths[], int *feeds[]);
+
+
+#endif
@@ -0,0 +1,242 @@
+#include "global.h" // (includes counters.h)
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+
+// names of the counters and phases, as printed
+const char *counter_names[NUM_COUNTERS] = {
+	"cycles", "instructions", "L1D misses", "LLC misses", "branch misses" };
+const char *counter_phase_names[NUM_PHASES] = {
+	"receive", "update", "move", "collide", "send", "display" };
+
+// leader of every thread's group (-1 if not counted; group 0 is the
+//	node's own thread, the others the local engine's pool threads), and
+//	each counter's place in a group's reads (-1 if unavailable)
+int counter_leaders[LOCAL_MAX_THREADS];
+int counter_slots[NUM_COUNTERS];
+int num_counters_open = 0;
+int counter_error = 0; // errno of the leader, if it failed
+
+// counts of every group at the last phase mark, and totals of every phase
+long long counter_last[LOCAL_MAX_THREADS][NUM_COUNTERS];
+long long counter_totals[NUM_PHASES][NUM_COUNTERS];
+
+
+/* Opens one counter of the calling thread (in the leader's group, or
+ *	as a new group's leader if leader is -1)
+ */
+int open_counter(int counter, int leader){
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	switch(counter){
+		case COUNTER_CYCLES: attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+		case COUNTER_INSTRUCTIONS: attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+		case COUNTER_L1_MISSES:
+			attr.type = PERF_TYPE_HW_CACHE;
+			attr.config = PERF_COUNT_HW_CACHE_L1D |
+				(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+				(PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+			break;
+		case COUNTER_LLC_MISSES: attr.config = PERF_COUNT_HW_CACHE_MISSES; break;
+		default: attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+	}
+	attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+		PERF_FORMAT_TOTAL_TIME_RUNNING;
+	attr.disabled = (leader < 0); // the group starts with its leader
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return (int)syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0);
+}
+
+
+/* Reads every open counter of a group (scaled up if the group was not
+ *	always on the hardware) into values; returns 0 if the read failed.
+ */
+int read_counters(int leader, long long values[]){
+	unsigned long long buffer[3 + NUM_COUNTERS];
+	if(read(leader, buffer, sizeof(buffer)) < (ssize_t)(3 * sizeof(long long)))
+		return 0;
+	double scale = 1.0;
+	if(buffer[2] > 0 && buffer[2] < buffer[1])
+		scale = (double)buffer[1] / buffer[2];
+	int c;
+	for(c=0; c<NUM_COUNTERS; c++){
+		values[c] = (counter_slots[c] < 0) ? 0 :
+			(long long)(buffer[3 + counter_slots[c]] * scale);
+	}
+	return 1;
+}
+
+
+/* Number of threads this node counts (the local engine's pool, on the
+ *	head node, or just the node's own thread)
+ */
+int counter_groups(){
+	if(node_role == ROLE_HEAD && local_threads > 1)
+		return local_threads;
+	return 1;
+}
+
+
+/* Starts a group that has been opened, and takes its first reading
+ *	into counter_last[group]; returns 0 (closing it) if it cannot be read.
+ */
+int start_counters(int group){
+	int leader = counter_leaders[group];
+	ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	if(!read_counters(leader, counter_last[group])){
+		close(leader);
+		counter_leaders[group] = -1;
+		return 0;
+	}
+	return 1;
+}
+
+
+/* ALL NODES: open the counters of this node's thread (if asked for) and
+ *	start counting.
+ */
+void init_counters(){
+	memset(counter_totals, 0, sizeof(counter_totals));
+	int g, c;
+	for(g=0; g<LOCAL_MAX_THREADS; g++){
+		counter_leaders[g] = -1;
+	}
+	if(!hardware_counters)
+		return;
+	for(c=0; c<NUM_COUNTERS; c++){
+		counter_slots[c] = -1;
+		int file = open_counter(c, counter_leaders[0]);
+		if(file < 0){
+			if(counter_leaders[0] < 0)
+				counter_error = errno;
+			continue;
+		}
+		if(counter_leaders[0] < 0)
+			counter_leaders[0] = file;
+		counter_slots[c] = num_counters_open++;
+	}
+	if(counter_leaders[0] < 0){
+		if(rank == 0)
+			printf("Warning: no hardware counters (%s).\n", strerror(counter_error));
+		return;
+	}
+	if(!start_counters(0))
+		counter_error = errno;
+}
+
+
+/* LOCAL ENGINE (each pool thread, once, before its first job): opens the
+ *	same counters for the calling thread, so its work is added to the
+ *	head node's phases too. (Every thread only touches its own group.)
+ */
+void counters_thread(int thread){
+	if(counter_leaders[0] < 0 || thread < 1 || thread >= LOCAL_MAX_THREADS)
+		return;
+	int c;
+	for(c=0; c<NUM_COUNTERS; c++){
+		if(counter_slots[c] < 0)
+			continue;
+		int file = open_counter(c, counter_leaders[thread]);
+		if(file < 0){
+			// (the group reads would not line up with counter_slots)
+			if(counter_leaders[thread] >= 0)
+				close(counter_leaders[thread]);
+			counter_leaders[thread] = -1;
+			break;
+		}
+		if(counter_leaders[thread] < 0)
+			counter_leaders[thread] = file;
+	}
+	if(counter_leaders[thread] >= 0)
+		start_counters(thread);
+}
+
+
+/* Adds the counts of every thread since the last call to the given phase
+ *	(the one that just ended; called by telemetry_phase).
+ */
+void counters_phase(int phase){
+	long long now[NUM_COUNTERS];
+	int groups = counter_groups();
+	int g, c;
+	for(g=0; g<groups; g++){
+		if(counter_leaders[g] < 0 || !read_counters(counter_leaders[g], now))
+			continue;
+		for(c=0; c<NUM_COUNTERS; c++){
+			counter_totals[phase][c] += now[c] - counter_last[g][c];
+			counter_last[g][c] = now[c];
+		}
+	}
+}
+
+
+/* ALL NODES (when done): print this node's totals per phase (phases
+ *	with no cycles are left out), with instructions per cycle.
+ */
+void report_counters(){
+	if(!hardware_counters)
+		return;
+	char role[32];
+	if(node_role == ROLE_ORGANISM)
+		sprintf(role, "%s shard %d", species[organism_type].name, shard_index);
+	else
+		strcpy(role, node_role == ROLE_HEAD ? "head" :
+			node_role == ROLE_COLLISION ? "collision" : "unused");
+	if(counter_leaders[0] < 0){
+		printf("(%d) #### Hardware counters (%s): unavailable (%s)\n",
+			rank, role, strerror(counter_error));
+		return;
+	}
+
+	// one printf, so the reports of different nodes do not interleave
+	char text[2048];
+	int groups = counter_groups();
+	int g, counted = 0;
+	for(g=0; g<groups; g++){
+		counted += (counter_leaders[g] >= 0);
+	}
+	int length = sprintf(text, "(%d) #### Hardware counters (%s", rank, role);
+	if(groups > 1)
+		length += sprintf(&text[length], ", %d of %d threads", counted, groups);
+	length += sprintf(&text[length], "):\n");
+	length += sprintf(&text[length], "(%d)   %-8s", rank, "phase");
+	int p, c;
+	for(c=0; c<NUM_COUNTERS; c++){
+		length += sprintf(&text[length], " %14s", counter_names[c]);
+	}
+	length += sprintf(&text[length], "    IPC\n");
+	for(p=0; p<NUM_PHASES; p++){
+		long long *totals = counter_totals[p];
+		if(totals[COUNTER_CYCLES] <= 0 && counter_slots[COUNTER_CYCLES] >= 0)
+			continue;
+		length += sprintf(&text[length], "(%d)   %-8s", rank, counter_phase_names[p]);
+		for(c=0; c<NUM_COUNTERS; c++){
+			if(counter_slots[c] < 0)
+				length += sprintf(&text[length], " %14s", "n/a");
+			else
+				length += sprintf(&text[length], " %14lld", totals[c]);
+		}
+		if(totals[COUNTER_CYCLES] > 0 && counter_slots[COUNTER_INSTRUCTIONS] >= 0){
+			length += sprintf(&text[length], " %6.2f\n",
+				(double)totals[COUNTER_INSTRUCTIONS] / totals[COUNTER_CYCLES]);
+		}
+		else{
+			length += sprintf(&text[length], "    n/a\n");
+		}
+	}
+	printf("%s", text);
+	for(g=0; g<groups; g++){
+		if(counter_leaders[g] >= 0)
+			close(counter_leaders[g]);
+		counter_leaders[g] = -1;
+	}
+}
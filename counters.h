@@ -0,0 +1,39 @@
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+
+/* HARDWARE COUNTERS:
+ *	If hardware_counters is set, every node counts cycles,
+ *	instructions, L1 data cache misses, last level cache misses and
+ *	branch misses (one perf_event_open group, read in one call), and
+ *	adds what was counted to the phase that just ended every time
+ *	telemetry_phase marks the end of one. So the collision loops land
+ *	in PHASE_COLLIDE, the movement loop in PHASE_MOVE, and so on. Every
+ *	node prints its totals per phase when it is done.
+ *	Counters the kernel or the hardware does not offer (in many VMs and
+ *	containers, or with a high perf_event_paranoid) are reported as
+ *	unavailable, and the simulation runs the same either way.
+ *	With the local engine, every pool thread opens its own group too
+ *	(perf counts one thread per group), and the head node adds all of
+ *	them up; the report says how many threads were counted.
+ */
+
+#define COUNTER_CYCLES 0
+#define COUNTER_INSTRUCTIONS 1
+#define COUNTER_L1_MISSES 2 // L1 data cache read misses
+#define COUNTER_LLC_MISSES 3 // last level cache misses
+#define COUNTER_BRANCH_MISSES 4
+#define NUM_COUNTERS 5
+
+// 1 to count (0 = off, the default)
+int hardware_counters;
+
+
+/* Counter methods (every node) */
+void init_counters();
+void counters_thread(int thread);
+void counters_phase(int phase);
+void report_counters();
+
+
+#endif
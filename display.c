@@ -1,14 +1,20 @@
 #include "display.h"
+#include "render.h"
+
+#include <string.h>
+#include <ctype.h>
 
 clock_t start_time;
 
+// RGB image buffer for the LOD heatmap
+unsigned char *lod_image;
+
 /* Initialize LOCATION ARRAYS: use the number of organisms provided
  *	to setup properly-sized display buffers.
  * Initialize GLUT: (setup display functions and all necessary
  *	Windowing utilities
  */
-void init_display(int argc, char **argv,
-		int num_plants, int num_herbivores, int num_predators){
+void init_display(int argc, char **argv){
 	
 	// start timer
 	start_time = clock();
@@ -16,43 +22,329 @@ void init_display(int argc, char **argv,
 	// true
 	simulating = 1;
 	
-	// definie number of organisms in global size variables
-	plant_loc_count = num_plants;
-	herbivore_loc_count = num_herbivores;
-	predator_loc_count = num_predators;
-	
-	
-	// allocate array memory:
-	//	number of that organism, times 2 (one for each coordinate:
+	// definie number of organisms in global size variables, and
+	//	allocate array memory for all organism types in one block:
+	//	number of organisms, times 2 (one for each coordinate:
 	//		that is, 1 for x, 1 for y...
-	//	then times sizeof(int), since int has (typically) 4 bytes,
-	//		we need to allocate 4 bytes per single coordinate int.
-	plant_locs = (float*)(malloc(plant_loc_count * 2 * sizeof(float)));
-	herbivore_locs = (float*)(malloc(herbivore_loc_count * 2 * sizeof(float)));
-	predator_locs = (float*)(malloc(predator_loc_count * 2 * sizeof(float)));
+	//	then times sizeof(float), since float has (typically) 4 bytes,
+	//		we need to allocate 4 bytes per single coordinate.
+	int total = 0;
+	int type;
+	for(type=0; type<num_species; type++){
+		organism_loc_count[type] = species[type].count;
+		total += species[type].count;
+	}
+	organism_loc_block = (float*)(malloc((total + 1) * 2 * sizeof(float)));
 		
+	// allocate density grids if running in LOD mode
+	if(lod_cell_size > 0){
+		organism_density_block = (int*)(malloc(
+			num_species * lod_cell_count() * sizeof(int)));
+		lod_image = (unsigned char*)(malloc(
+			lod_grid_width * lod_grid_height * 3 * sizeof(unsigned char)));
+	}
+		
+	// open the trajectory recording (if recording)
+	init_recorder();
+	
 	// fill arrays up!
-	MPIRecvPosReport(
-		plant_locs, plant_loc_count * 2,
-		herbivore_locs, herbivore_loc_count * 2,
-		predator_locs, predator_loc_count * 2);
+	receive_reports();
+	
+	// HEADLESS MODE: no GLUT window, simulate (and export frames)
+	//	until the simulation ends
+	if(headless){
+		run_headless();
+		return;
+	}
 		
+	// initialize GLUT and start main loop
+	printf("Keys: w/a/s/d pan, +/- zoom, 0 whole world, q quit.\n");
+	init_window(argc, argv, "EnvSim Display UI",
+		idle_func, keyboard_func, terminate);
+}
+
+
+/* Initialize GLUT: create the window, register the display function and
+ *	the given idle, keyboard and close functions, and start the main loop.
+ *	(also used by the replay viewer, which has its own idle and keys)
+ */
+void init_window(int argc, char **argv, char *title,
+		void (*idle)(), void (*keyboard)(unsigned char, int, int),
+		void (*close)()){
+	
 	// initialize GLUT
 	glutInit(&argc, argv);
 	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
 	glutInitWindowSize(WINDOW_WIDTH, WINDOW_HEIGHT);
-	glutCreateWindow("EnvSim Display UI");
+	glutCreateWindow(title);
 	
 	// initialize GLUT functions (display, idle, keyboard, close)
 	glutDisplayFunc(display_func);
-	glutIdleFunc(idle_func);
-	glutKeyboardFunc(keyboard_func);
-	glutCloseFunc(terminate);
+	glutIdleFunc(idle);
+	glutKeyboardFunc(keyboard);
+	glutCloseFunc(close);
 	
 	// start main loop
 	glutMainLoop();
 }
 
+
+/* Receives this update's reports from the worker nodes, either as
+ *	position lists or (in LOD mode) as density grids.
+ */
+void receive_reports(){
+	int stats[NUMBER_OF_ORGANISMS][3];
+	
+	// LOCAL ENGINE: run the exchange here, and read the populations
+	if(local_threads > 0){
+		local_step();
+		local_report(stats);
+	}
+	
+	// every shard's header first: populations and statistics
+	else{
+		MPIRecvReportHeaders(stats);
+		
+		if(lod_cell_size > 0){
+			MPIRecvDensityReport(organism_density_block, organism_density,
+				lod_cell_count());
+		}
+		else{
+			MPIRecvPosReport(organism_loc_block, organism_locs);
+		}
+		telemetry_phase(PHASE_RECEIVE);
+	}
+	
+	// RECORDING: record each organism type's statistics for this step
+	//	(plus a position snapshot every snapshot_interval)
+	if(record_path != NULL){
+		record_step(sim_step, stats);
+		
+		if(lod_cell_size == 0 && step_reached(snapshot_interval)){
+			record_frame(sim_step);
+		}
+	}
+	// and only show what is inside the viewport
+	if(world_report)
+		crop_view();
+	telemetry_phase(PHASE_DISPLAY);
+}
+
+
+/* VIEWPORT: start with the whole world in view.
+ *	Called on every node, since workers cull and head pans and zooms.
+ */
+void init_view(){
+	view[0] = 0;
+	view[1] = 0;
+	view[2] = world_width;
+	view[3] = world_height;
+	view_changed = 0;
+}
+
+/* VIEWPORT: keep the viewport inside the world, and at least
+ *	VIEW_MIN_WIDTH wide (keeping its shape), and mark it changed.
+ */
+void clamp_view(){
+	if(view[2] < VIEW_MIN_WIDTH){
+		view[3] = view[3] * VIEW_MIN_WIDTH / view[2];
+		view[2] = VIEW_MIN_WIDTH;
+	}
+	if(view[2] > world_width)
+		view[2] = world_width;
+	if(view[3] > world_height)
+		view[3] = world_height;
+	if(view[3] < 1)
+		view[3] = 1;
+	if(view[0] > world_width - view[2])
+		view[0] = world_width - view[2];
+	if(view[1] > world_height - view[3])
+		view[1] = world_height - view[3];
+	if(view[0] < 0)
+		view[0] = 0;
+	if(view[1] < 0)
+		view[1] = 0;
+	view_changed = 1;
+}
+
+/* VIEWPORT (HEAD NODE): move the viewport by dx, dy eighths of its size */
+void pan_view(int dx, int dy){
+	view[0] += dx * view[2] / 8;
+	view[1] += dy * view[3] / 8;
+	clamp_view();
+}
+
+/* VIEWPORT (HEAD NODE): halve (zoom in) or double (zoom out) the
+ *	viewport around its center.
+ */
+void zoom_view(int zoom_in){
+	int center_x = view[0] + view[2] / 2;
+	int center_y = view[1] + view[3] / 2;
+	if(zoom_in){
+		view[2] /= 2;
+		view[3] /= 2;
+	}
+	else{
+		view[2] *= 2;
+		view[3] *= 2;
+	}
+	view[0] = center_x - view[2] / 2;
+	view[1] = center_y - view[3] / 2;
+	clamp_view();
+}
+
+/* The organisms (absolute pixel positions, x followed by y) inside an
+ *	area of the world (x, y, width, height), scaled to the relative
+ *	(-1, 1) window coordinates OpenGL renders in. Returns how many
+ *	there are.
+ */
+int area_positions(int area[], int positions[], int count, float locs[]){
+	int visible = 0;
+	int i;
+	for(i=0; i<count; i++){
+		int x = positions[2*i] - area[0];
+		int y = positions[2*i+1] - area[1];
+		if(x < 0 || x >= area[2] || y < 0 || y >= area[3])
+			continue;
+		float xpos = (float)x / area[2];
+		locs[2*visible] = xpos * 2 - 1.0;
+		float ypos = (float)y / area[3];
+		locs[2*visible+1] = ypos * 2 - 1.0;
+		visible++;
+	}
+	return visible;
+}
+
+/* VIEWPORT (WORKER NODES): the positions to report, those inside the
+ *	viewport (or all of them, over the whole world, for a snapshot).
+ */
+int view_positions(int positions[], int count, float locs[]){
+	if(world_report){
+		int world[4] = { 0, 0, world_width, world_height };
+		return area_positions(world, positions, count, locs);
+	}
+	return area_positions(view, positions, count, locs);
+}
+
+/* VIEWPORT (HEAD NODE): crops a snapshot report (every organism, over
+ *	the whole world) to the viewport in place, just as the organism
+ *	nodes would have reported it.
+ */
+void crop_view(){
+	int type, i;
+	for(type=0; type<num_species; type++){
+		float *locs = organism_locs[type];
+		int position[2];
+		int visible = 0;
+		for(i=0; i<organism_view_count[type]; i++){
+			// back to world pixels, then into the viewport
+			position[0] = (int)((locs[2*i] + 1.0) / 2 * world_width + 0.5);
+			position[1] = (int)((locs[2*i+1] + 1.0) / 2 * world_height + 0.5);
+			visible += area_positions(view, position, 1, &locs[2*visible]);
+		}
+		organism_view_count[type] = visible;
+	}
+}
+
+
+/* LOD: set up the density grid dimensions from lod_cell_size.
+ *	Called on every node, since workers rasterize and head renders.
+ */
+void init_lod(){
+	if(lod_cell_size <= 0){
+		lod_cell_size = 0;
+		return;
+	}
+	lod_grid_width = (WINDOW_WIDTH + lod_cell_size - 1) / lod_cell_size;
+	lod_grid_height = (WINDOW_HEIGHT + lod_cell_size - 1) / lod_cell_size;
+}
+
+/* LOD: number of ints in a density report (population + one per cell) */
+int lod_cell_count(){
+	return 1 + lod_grid_width * lod_grid_height;
+}
+
+/* LOD (WORKER NODES): rasterize count organisms at absolute pixel
+ *	positions (x followed by y) into the given density report buffer
+ *	(only those inside the viewport, scaled to window pixels).
+ */
+void rasterize_density(int positions[], int count, int density[]){
+	memset(density, 0, lod_cell_count() * sizeof(int));
+	density[0] = count;
+	
+	int *cells = &density[1];
+	int i;
+	for(i=0; i<count; i++){
+		int x = positions[2*i] - view[0];
+		int y = positions[2*i+1] - view[1];
+		if(x < 0 || x >= view[2] || y < 0 || y >= view[3])
+			continue;
+		int cx = x * WINDOW_WIDTH / view[2] / lod_cell_size;
+		int cy = y * WINDOW_HEIGHT / view[3] / lod_cell_size;
+		// (just in case of rounding at the edges)
+		if(cx < 0) cx = 0;
+		if(cx >= lod_grid_width) cx = lod_grid_width - 1;
+		if(cy < 0) cy = 0;
+		if(cy >= lod_grid_height) cy = lod_grid_height - 1;
+		cells[cy * lod_grid_width + cx]++;
+	}
+}
+
+/* LOD: map an organism count in a cell to a color intensity, so that
+ *	a single organism is still visible and dense cells saturate.
+ */
+unsigned char lod_intensity(int count){
+	if(count <= 0)
+		return 0;
+	int value = 80 + count * 16;
+	return (unsigned char)(value > 255 ? 255 : value);
+}
+
+/* LOD: color of one cell of the heatmap (0xRRGGBB): every organism
+ *	type adds its own color, scaled by its intensity in the cell.
+ *	(with the built-in food web: plants green, herbivores blue,
+ *	predators red, as in the point display)
+ */
+unsigned int lod_color(int cell){
+	unsigned int channels[3] = { 0, 0, 0 };
+	int type, c;
+	for(type=0; type<num_species; type++){
+		if(organism_loc_count[type] <= 0)
+			continue;
+		unsigned int intensity = lod_intensity(organism_density[type][cell+1]);
+		for(c=0; c<3; c++){
+			unsigned int part = (species[type].color >> (16 - 8*c)) & 0xFF;
+			channels[c] += intensity * part / 255;
+		}
+	}
+	for(c=0; c<3; c++){
+		if(channels[c] > 255)
+			channels[c] = 255;
+	}
+	return (channels[0] << 16) | (channels[1] << 8) | channels[2];
+}
+
+/* LOD: draw the density grids of all types as one heatmap image */
+void display_density(){
+	int num_cells = lod_grid_width * lod_grid_height;
+	
+	int i;
+	for(i=0; i<num_cells; i++){
+		unsigned int color = lod_color(i);
+		lod_image[3*i] = (color >> 16) & 0xFF;
+		lod_image[3*i+1] = (color >> 8) & 0xFF;
+		lod_image[3*i+2] = color & 0xFF;
+	}
+	
+	// stretch the grid over the whole window
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glRasterPos2f(-1.0, -1.0);
+	glPixelZoom((float)WINDOW_WIDTH / lod_grid_width,
+		(float)WINDOW_HEIGHT / lod_grid_height);
+	glDrawPixels(lod_grid_width, lod_grid_height,
+		GL_RGB, GL_UNSIGNED_BYTE, lod_image);
+}
+
 /* Initialize GL: set up OpenGL properties */
 void init_graphics(){
 	glMatrixMode(GL_PROJECTION);
@@ -69,29 +361,30 @@ void display_func(){
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	glLoadIdentity();
 	
+	// LOD mode: render density heatmap instead of points
+	if(lod_cell_size > 0){
+		display_density();
+		glutSwapBuffers();
+		return;
+	}
+	
 	// set size of each rendered point!
 	glPointSize(4.0);
 	
 	// DISPLAY ORGANISMS!
 	glBegin(GL_POINTS); // start creating POINT vertices
 	
-		// display plants:
-		glColor3f(0.0, 1.0, 0.0); // green
-		int i;
-		for(i = 0; i<plant_loc_count; i++){
-			glVertex2f(plant_locs[i*2], plant_locs[i*2+1]);
-		}
-		
-		// display herbivores
-		glColor3f(0.0, 0.0, 1.0); // blue
-		for(i = 0; i<herbivore_loc_count; i++){
-			glVertex2f(herbivore_locs[i*2], herbivore_locs[i*2+1]);
-		}
-		
-		// display predators
-		glColor3f(1.0, 0.0, 0.0); // red
-		for(i = 0; i<predator_loc_count; i++){
-			glVertex2f(predator_locs[i*2], predator_locs[i*2+1]);
+		// display every organism type in its own color (in food web
+		//	order: plants green, herbivores blue, predators red)
+		int type, i;
+		for(type = 0; type<num_species; type++){
+			int color = species[type].color;
+			glColor3f(((color >> 16) & 0xFF) / 255.0,
+				((color >> 8) & 0xFF) / 255.0, (color & 0xFF) / 255.0);
+			float *locs = organism_locs[type];
+			for(i = 0; i<organism_view_count[type]; i++){
+				glVertex2f(locs[i*2], locs[i*2+1]);
+			}
 		}
 		
 	glEnd(); // finish making vertices
@@ -101,45 +394,135 @@ void display_func(){
 }
 
 
-/* GLUT IDLE FUNCTION: collects updates from every node, and stores
- *	them in proper display buffers, later used to render with OpenGL's
- *	display function.
+/* HEADLESS MODE: replaces the GLUT main loop. Steps the simulation,
+ *	and rasterizes and exports a frame every frame_interval steps
+ *	with the offscreen renderer (render.c).
+ */
+void run_headless(){
+	printf("Head node running headless (frame every %d steps).\n",
+		frame_interval);
+	if(frame_interval > 0)
+		init_renderer();
+	
+	while(1){
+		if(step_reached(frame_interval)){
+			render_frame();
+			export_frame(sim_step);
+		}
+		step_simulation();
+	}
+}
+
+
+/* GLUT IDLE FUNCTION: steps the simulation, then has OpenGL redraw
+ *	the updated display buffers.
  */
 void idle_func(){
+	step_simulation();
+	
+	// tell OpenGL to refresh (call display function again)
+	glutPostRedisplay();
+}
+
+
+/* Whether the last report reached (or passed) a multiple of interval
+ *	steps: with sub-stepping, only every substeps-th step is reported.
+ *	The first report (step 0) always counts.
+ */
+int step_reached(int interval){
+	if(interval <= 0)
+		return 0;
+	if(sim_step == 0)
+		return 1;
+	return (sim_step / interval) != ((sim_step - substeps) / interval);
+}
+
+
+/* SIMULATION STEP: collects updates from every node, and stores
+ *	them in proper display buffers, later used to render with OpenGL's
+ *	display function (or the offscreen renderer).
+ */
+void step_simulation(){
+	// time since the last step went to drawing (or exporting frames)
+	telemetry_phase(PHASE_DISPLAY);
+	
+	// every checkpoint_interval steps, ask all nodes to checkpoint
+	int message = simulating; // 1 = true
+	if(simulating && sim_step > 0 && step_reached(checkpoint_interval)){
+		message |= CONTINUE_CHECKPOINT;
+	}
+	// and have the organism nodes report from the new viewport
+	//	(the local engine reads it directly)
+	if(simulating && view_changed && local_threads == 0){
+		message |= CONTINUE_VIEWPORT;
+	}
+	// have the organism nodes report every organism when the next
+	//	report gets recorded (the local engine reads it directly)
+	world_report = (simulating && record_path != NULL && lod_cell_size == 0
+		&& snapshot_interval > 0 && (sim_step + substeps) / snapshot_interval
+			!= sim_step / snapshot_interval);
+	if(world_report && local_threads == 0){
+		message |= CONTINUE_SNAPSHOT;
+	}
+	// every analytics_interval steps, have all nodes add up analytics
+	if(simulating && step_reached(analytics_interval)){
+		message |= CONTINUE_ANALYTICS;
+	}
+	
 	// respond positively to all nodes
-	MPISendContinue(simulating); // 1 = true
+	MPISendContinue(message);
+	if(message & CONTINUE_VIEWPORT){
+		MPISendViewport(view);
+		view_changed = 0;
+	}
+	
+	// analytics of the step just reported (the local engine adds up
+	//	everything here)
+	if(message & CONTINUE_ANALYTICS){
+		analytics_begin();
+		if(local_threads > 0)
+			local_analytics();
+		analytics_reduce(sim_step);
+	}
+	
+	// head node writes the checkpoint header
+	if(message & CONTINUE_CHECKPOINT){
+		checkpoint_stage();
+		checkpoint_write();
+	}
+	checkpoint_progress();
+	telemetry_phase(PHASE_SEND);
 	
 	if(simulating == 0){
 		terminate();
 	}
 
-	// fill arrays up!
-	MPIRecvPosReport(
-		plant_locs, plant_loc_count * 2,
-		herbivore_locs, herbivore_loc_count * 2,
-		predator_locs, predator_loc_count * 2);
+	// fill arrays up! (organism nodes advance substeps steps per report)
+	sim_step += substeps;
+	receive_reports();
+	int total = 0;
+	int extinct = -1;
+	int type;
+	for(type=0; type<num_species; type++){
+		total += organism_loc_count[type];
+		if(organism_loc_count[type] == 0 && extinct < 0)
+			extinct = type;
+	}
+	telemetry_publish(sim_step, total, 0, 0);
 	
-	if(plant_loc_count == 0){
+	// stop when any organism type dies out
+	if(extinct >= 0){
 		printf("----------------------------------------------\n");
-		printf("::::: Simulation over: Plant extinction. :::::\n");
-		printf("::::: Herbivores: %d     Predators: %d\n",
-			herbivore_loc_count, predator_loc_count);
+		printf("::::: Simulation over: %c%s extinction. :::::\n",
+			toupper(species[extinct].name[0]), &species[extinct].name[1]);
+		print_populations(organism_loc_count);
 		printf("----------------------------------------------\n");
 		simulating = 0;
 	}
-	else if(herbivore_loc_count == 0){
-		printf("--------------------------------------------------\n");
-		printf("::::: Simulation over: Herbivore extinction. :::::\n");
-		printf("::::: Plants: %d     Predators: %d\n",
-			plant_loc_count, predator_loc_count);
-		printf("--------------------------------------------------\n");
-		simulating = 0;
-	}
-	else if(predator_loc_count == 0){
+	else if(max_steps > 0 && sim_step >= max_steps){
 		printf("-------------------------------------------------\n");
-		printf("::::: Simulation over: Predator extinction. :::::\n");
-		printf("::::: Plants: %d     Herbivores: %d\n",
-			plant_loc_count, herbivore_loc_count);
+		printf("::::: Simulation over: Reached %d steps. :::::\n", sim_step);
+		print_populations(organism_loc_count);
 		printf("-------------------------------------------------\n");
 		simulating = 0;
 	}
@@ -150,8 +533,6 @@ void idle_func(){
 		double time_diff =  (double)(now_time - start_time) / CLOCKS_PER_SEC;;
 		printf("Simulation runtime (in seconds): %f\n", time_diff);
 	}
-	// tell OpenGL to refresh (call display function again)
-	glutPostRedisplay();
 }
 
 
@@ -164,6 +545,18 @@ void keyboard_func(unsigned char key, int x, int y){
 	if(key == 'q' || key == 27){
 		terminate();
 	}
+	
+	// w, a, s, d :: pan the viewport, + and - :: zoom in and out,
+	//	0 :: show the whole world again
+	switch(key){
+		case 'w': pan_view(0, 1); break;
+		case 's': pan_view(0, -1); break;
+		case 'a': pan_view(-1, 0); break;
+		case 'd': pan_view(1, 0); break;
+		case '+': case '=': zoom_view(1); break;
+		case '-': zoom_view(0); break;
+		case '0': init_view(); view_changed = 1; break;
+	}
 }
 
 /* GLUT MOUSE FUNCTION: listens to mouse input, and acts
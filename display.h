@@ -14,23 +14,97 @@
 #define WINDOW_WIDTH 800
 #define WINDOW_HEIGHT 600
 
+// size of the simulated world (in pixels), which organisms move in:
+//	the window's size unless set on the command line
+int world_width;
+int world_height;
+
+
+/* VIEWPORT: the part of the world shown in the window (x and y of its
+ *	bottom left corner, width and height, in world pixels). Organism
+ *	nodes only report the organisms inside it, with positions relative
+ *	to it, so the display traffic grows with what is on screen and not
+ *	with the population. The head node pans and zooms it from the
+ *	keyboard, and sends every change with the next continue message
+ *	(see CONTINUE_VIEWPORT). It starts out as the whole world.
+ */
+int view[4];
+int view_changed;
+
+// smallest viewport width (in world pixels)
+#define VIEW_MIN_WIDTH 50
+
+/* SNAPSHOT REPORTS: the reports of a step the head node records
+ *	positions of (see recorder.h) hold every organism, scaled to the
+ *	whole world instead of the viewport, so recordings do not depend on
+ *	where the window looks. The head node crops them to the viewport
+ *	itself (see crop_view); organism nodes are told by CONTINUE_SNAPSHOT.
+ */
+int world_report;
+
 
 /* DISPLAY BUFFERS:
  *	This is where the buffers that store location data for
- *	each organism are located.
+ *	each organism type are located (organism_view_count[type] each,
+ *	the ones inside the viewport; organism_loc_count is the whole
+ *	population). Reports are received into one block, and
+ *	organism_locs point at each type's part of it.
  */
-float *plant_locs;
-float *herbivore_locs;
-float *predator_locs;
+float *organism_loc_block;
+float *organism_locs[NUMBER_OF_ORGANISMS];
+int organism_view_count[NUMBER_OF_ORGANISMS];
 
 // 1 if true, 0 if false (stop the simulation)
 int simulating;
 
+// number of steps simulated so far, and the limit (0 = no limit)
+//	(with sub-stepping, sim_step grows by substeps every report)
+int sim_step;
+int max_steps;
+
+
+/* LEVEL-OF-DETAIL (LOD) MODE:
+ *	If lod_cell_size > 0, worker nodes rasterize their organisms into
+ *	a density grid of lod_cell_size x lod_cell_size pixel cells and send
+ *	that to the head node instead of every position. The grid buffers
+ *	hold the population count in index 0, followed by one count per
+ *	cell (row 0 is the bottom of the window, same as OpenGL). The grid
+ *	covers the viewport, so its cells are window pixels, not world ones.
+ */
+int lod_cell_size;
+int lod_grid_width;
+int lod_grid_height;
+
+int *organism_density_block;
+int *organism_density[NUMBER_OF_ORGANISMS];
+
 
 /* Display methods */
-void init_display(int argc, char **argv,
-	int num_plants, int num_herbavores, int num_predators);
+void init_display(int argc, char **argv);
 void init_graphics();
+void init_window(int argc, char **argv, char *title,
+	void (*idle)(), void (*keyboard)(unsigned char, int, int),
+	void (*close)());
+void receive_reports();
+void step_simulation();
+void run_headless();
+int step_reached(int interval);
+
+/* Viewport methods */
+void init_view();
+void pan_view(int dx, int dy);
+void zoom_view(int zoom_in);
+int area_positions(int area[], int positions[], int count, float locs[]);
+int view_positions(int positions[], int count, float locs[]);
+void crop_view();
+
+/* LOD methods */
+void init_lod();
+int lod_cell_count();
+void rasterize_density(int positions[], int count, int density[]);
+void display_density();
+unsigned char lod_intensity(int count);
+unsigned int lod_color(int cell);
 
 /* GLUT window functions */
 void display_func();
@@ -0,0 +1,229 @@
+#include "ensemble.h"
+
+#include <string.h>
+
+
+// this group's result, and when the group started
+EnsembleResult ensemble_result;
+double ensemble_start_time;
+
+
+/* Reads the sweep file (up to max lines). Returns the number of runs,
+ *	or -1 if the file cannot be read.
+ */
+int read_sweep(char *path, EnsembleRun runs[], int max){
+	FILE *file = fopen(path, "r");
+	if(file == NULL)
+		return -1;
+	char line[256];
+	int count = 0;
+	while(count < max && fgets(line, sizeof(line), file) != NULL){
+		char *comment = strchr(line, '#');
+		if(comment != NULL)
+			*comment = '\0';
+		// seed, then one count per species of the food web
+		EnsembleRun *run = &runs[count];
+		char *cursor = line;
+		int used;
+		int read = 0;
+		while(read <= num_species &&
+				sscanf(cursor, "%d%n", read ? &run->counts[read-1] : &run->seed,
+				&used) == 1){
+			cursor += used;
+			read++;
+		}
+		if(read == num_species + 1)
+			count++;
+	}
+	fclose(file);
+	return count;
+}
+
+
+/* Gives a group its own copy of an output path (path.gN) */
+char *group_path(char *path){
+	if(path == NULL)
+		return NULL;
+	char *grouped = (char*)(malloc(strlen(path) + 16));
+	sprintf(grouped, "%s.g%d", path, ensemble_group);
+	return grouped;
+}
+
+
+/* ALL NODES (right after MPI_Init): node 0 reads the sweep file and
+ *	sends it to every node. Nodes are then split into groups, and
+ *	every group takes the seed and populations of its line.
+ *	Nodes that do not fit into a whole group get MPI_COMM_NULL.
+ */
+void init_ensemble(){
+	int world_rank, world_size;
+	MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+
+	EnsembleRun *runs = (EnsembleRun*)(malloc(
+		ENSEMBLE_MAX_RUNS * sizeof(EnsembleRun)));
+	int num_runs = 0;
+	if(world_rank == 0)
+		num_runs = read_sweep(ensemble_path, runs, ENSEMBLE_MAX_RUNS);
+	MPI_Bcast(&num_runs, 1, MPI_INT, 0, MPI_COMM_WORLD);
+	if(num_runs <= 0){
+		if(world_rank == 0)
+			printf("Error: no runs in sweep file %s\n", ensemble_path);
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+	MPI_Bcast(runs, num_runs * sizeof(EnsembleRun), MPI_BYTE,
+		0, MPI_COMM_WORLD);
+
+	// nodes per group: a head node, a node per species and one per
+	//	interaction (6 for the built-in web; FUSED: one for all), plus
+	//	the extra shards asked for
+	int group_size = 1 + num_species + num_interactions;
+	if(fused_collisions && num_interactions > 1)
+		group_size = 2 + num_species;
+	int t;
+	for(t=0; t<NUMBER_OF_ORGANISMS; t++){
+		if(requested_shards[t] > 1)
+			group_size += requested_shards[t] - 1;
+	}
+	num_groups = world_size / group_size;
+	if(num_groups > num_runs)
+		num_groups = num_runs;
+	if(num_groups == 0){
+		if(world_rank == 0)
+			printf("Error: ensemble needs at least %d nodes.\n", group_size);
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+	if(world_rank == 0){
+		printf("Ensemble: %d groups of %d nodes (%d runs in %s).\n",
+			num_groups, group_size, num_runs, ensemble_path);
+		if(num_runs > num_groups){
+			printf("Warning: %d runs in %s did not fit and are skipped.\n",
+				num_runs - num_groups, ensemble_path);
+		}
+	}
+
+	ensemble_group = world_rank / group_size;
+	if(ensemble_group >= num_groups)
+		ensemble_group = -1;
+	MPI_Comm_split(MPI_COMM_WORLD,
+		ensemble_group >= 0 ? ensemble_group : MPI_UNDEFINED,
+		world_rank, &sim_comm);
+
+	ensemble_result.group = -1;
+	ensemble_start_time = MPI_Wtime();
+	if(ensemble_group >= 0){
+		// this group's line of the sweep file
+		EnsembleRun *run = &runs[ensemble_group];
+		sim_seed = run->seed;
+		for(t=0; t<num_species; t++){
+			species[t].count = run->counts[t];
+		}
+
+		// no windows, and no two groups writing the same file
+		headless = 1;
+		record_path = group_path(record_path);
+		restart_path = group_path(restart_path);
+		video_path = group_path(video_path);
+		if(checkpoint_interval > 0){
+			if(checkpoint_path == NULL)
+				checkpoint_path = "envsim.ckpt";
+			checkpoint_path = group_path(checkpoint_path);
+		}
+		if(analytics_interval > 0){
+			if(analytics_path == NULL)
+				analytics_path = "envsim.analytics";
+			analytics_path = group_path(analytics_path);
+		}
+		char *prefix = (char*)(malloc(
+			(frame_prefix ? strlen(frame_prefix) : 8) + 16));
+		sprintf(prefix, "%sg%d_", frame_prefix ? frame_prefix : "frame_",
+			ensemble_group);
+		frame_prefix = prefix;
+	}
+	free(runs);
+}
+
+
+/* HEAD NODES: note how this group's run ended */
+void ensemble_record(){
+	if(ensemble_path == NULL)
+		return;
+	ensemble_result.group = ensemble_group;
+	ensemble_result.seed = sim_seed;
+	int t;
+	for(t=0; t<num_species; t++){
+		ensemble_result.start_counts[t] = species[t].count;
+		ensemble_result.final_counts[t] = organism_loc_count[t];
+	}
+	ensemble_result.steps = sim_step;
+	ensemble_result.milliseconds =
+		(int)((MPI_Wtime() - ensemble_start_time) * 1000);
+}
+
+
+/* Prints (or writes) one summary line */
+void print_result(FILE *file, EnsembleResult *result){
+	fprintf(file, "%5d %11d", result->group, result->seed);
+	int t;
+	for(t=0; t<num_species; t++){
+		fprintf(file, " %10d", result->start_counts[t]);
+	}
+	for(t=0; t<num_species; t++){
+		fprintf(file, " %10d", result->final_counts[t]);
+	}
+	fprintf(file, " %8d %9d\n", result->steps, result->milliseconds);
+}
+
+
+/* ALL NODES (before MPI_Finalize): gather every group's result on
+ *	node 0, and print the summary.
+ */
+void ensemble_finish(){
+	if(ensemble_path == NULL)
+		return;
+
+	int world_rank, world_size;
+	MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+	EnsembleResult *results = NULL;
+	if(world_rank == 0){
+		results = (EnsembleResult*)(malloc(
+			world_size * sizeof(EnsembleResult)));
+	}
+	MPI_Gather(&ensemble_result, sizeof(EnsembleResult), MPI_BYTE,
+		results, sizeof(EnsembleResult), MPI_BYTE, 0, MPI_COMM_WORLD);
+	if(world_rank != 0)
+		return;
+
+	FILE *summary = NULL;
+	if(summary_path != NULL){
+		summary = fopen(summary_path, "w");
+		if(summary == NULL)
+			printf("Error: could not write summary %s\n", summary_path);
+	}
+	// columns: starting, then final (_e) population of every species
+	char columns[64 + 24 * NUMBER_OF_ORGANISMS];
+	int length = sprintf(columns, "group        seed");
+	int i;
+	for(i=0; i<num_species; i++){
+		length += sprintf(&columns[length], " %10.10s", species[i].name);
+	}
+	for(i=0; i<num_species; i++){
+		length += sprintf(&columns[length], " %8.8s_e", species[i].name);
+	}
+	sprintf(&columns[length], "    steps   time_ms\n");
+	printf("------------------- ENSEMBLE SUMMARY -------------------\n");
+	printf("%s", columns);
+	if(summary != NULL)
+		fprintf(summary, "#%s", columns);
+	for(i=0; i<world_size; i++){
+		if(results[i].group < 0)
+			continue;
+		print_result(stdout, &results[i]);
+		if(summary != NULL)
+			print_result(summary, &results[i]);
+	}
+	if(summary != NULL)
+		fclose(summary);
+	free(results);
+}
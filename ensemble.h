@@ -0,0 +1,60 @@
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+
+/* Contains functions for global operations */
+#include "global.h"
+
+
+/* ENSEMBLE MODE:
+ *	Runs many independent simulations in one MPI job. The nodes are
+ *	split into groups, each a whole simulation (head, organism and
+ *	collision nodes) on its own communicator (sim_comm), so all groups
+ *	run at the same time. Each group takes one line of the sweep file:
+ *		seed <count of every species, in food web order>
+ *	e.g. "seed plants herbivores predators" for the built-in web
+ *	(anything after a '#' is a comment).
+ *	Groups have a head node, a node per species and one per interaction
+ *	(6 for the built-in web) plus any extra shards, run headless, and their
+ *	output files get ".g<group>" appended ("g<group>_" after the frame
+ *	prefix). When every group is done, node 0 prints one summary line
+ *	per group, and writes the summary to summary_path (if set).
+ */
+
+// most lines read from a sweep file
+#define ENSEMBLE_MAX_RUNS 4096
+
+
+// one line of the sweep file
+typedef struct {
+	int seed;
+	int counts[NUMBER_OF_ORGANISMS];
+} EnsembleRun;
+
+// result of one group's run (filled in by its head node)
+typedef struct {
+	int group; // -1 on all other nodes
+	int seed;
+	int start_counts[NUMBER_OF_ORGANISMS];
+	int final_counts[NUMBER_OF_ORGANISMS];
+	int steps;
+	int milliseconds;
+} EnsembleResult;
+
+
+// sweep file (NULL = a single simulation on all nodes), summary file
+char *ensemble_path;
+char *summary_path;
+
+// this node's group (-1 if left over), and the number of groups
+int ensemble_group;
+int num_groups;
+
+
+/* Ensemble methods */
+void init_ensemble();
+void ensemble_record();
+void ensemble_finish();
+
+
+#endif
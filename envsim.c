@@ -12,11 +12,47 @@ int num_plants = 100000;
 int num_herbivores = 2000;
 int num_predators = 450;
 
+// rebalance sharded organism types every 50 steps
+int rebalance_interval = 50;
+
+// exchange positions every step
+int substeps = 1;
+
+// one collision node per interaction (as far as nodes go)
+int fused_collisions = 0;
+
+// distributed (a single process runs the local engine anyway)
+int local_threads = 0;
+
+// every collision node picks its fastest kernels
+int collision_autotune = 1;
+
+// no hardware counters
+int hardware_counters = 0;
+
+// no analytics (written to envsim.analytics when on)
+int analytics_interval = 0;
+char *analytics_path = NULL;
+
+// settings from the command line only
+char *scenario_path = NULL;
+
+// world as big as the window
+int world_width = WINDOW_WIDTH;
+int world_height = WINDOW_HEIGHT;
+
+// sort organisms into Morton order every 20 steps
+int morton_interval = 20;
+
+// let MPI renumber nodes to fit the communication graph
+int topology_reorder = 1;
+
 
 
 
 /*************************************************************/
-/***** OLD CODE: DOES NOT WORK WITH "make run" AS OF NOW *****/
+/***** ARGUMENTS: COMMAND LINE (make run ARGS="...") AND *****/
+/***** SCENARIO FILES (see scenario.h)                   *****/
 /*************************************************************/
 /* Prints a list of commands that can be used and how... */
 void print_help(){
@@ -27,6 +63,69 @@ void print_help(){
 		printf("   -plnt # :: number of plants to initialize.\n");
 		printf("   -herb # :: number of herbivores to initialize.\n");
 		printf("   -pred # :: number of predators to initialize.\n");
+		printf("              (-plnt, -herb and -pred set the built-in food web)\n");
+		printf("   -scenario file :: read settings (arguments, one per line) and\n");
+		printf("              maybe a food web from a file (see scenario.h);\n");
+		printf("              the command line wins over it.\n");
+		printf("   -foodweb file :: read the species and who eats whom from a\n");
+		printf("              file (see foodweb.h) instead of the built-in web\n");
+		printf("              of plants, herbivores and predators.\n");
+		printf("   -world WxH :: size of the world organisms live in (default\n");
+		printf("              the window's, 800x600); the window shows a\n");
+		printf("              viewport of it (w/a/s/d pan, +/- zoom, 0 all).\n");
+		printf("   -plntshards # :: split plants over # nodes (extra nodes\n");
+		printf("              come after the collision nodes; same for -herbshards,\n");
+		printf("              -predshards, which set the food web's first 3 species).\n");
+		printf("   -rebalance # :: even out shard work every # steps (0 = off).\n");
+		printf("   -substeps # :: move organisms # steps between exchanges\n");
+		printf("              (collisions use the swept path; default 1).\n");
+		printf("   -local # :: run the whole simulation in the head node's\n");
+		printf("              process with # threads, no MPI messages\n");
+		printf("              (the default when started as one process).\n");
+		printf("   -autotune # :: 1 = time the collision kernels (brute force,\n");
+		printf("              grid, sweep) as populations swing, and use the\n");
+		printf("              fastest (default); 0 = always brute force.\n");
+		printf("   -fused # :: 1 = resolve every interaction on one collision\n");
+		printf("              node in one pass (default 0).\n");
+		printf("   -perceive # :: predators chase and prey flee within\n");
+		printf("              # pixels (0 = off, default).\n");
+		printf("   -morton # :: sort organisms into Morton order every # steps\n");
+		printf("              for memory locality (0 = off, default 20).\n");
+		printf("   -seed # :: random seed (default: from the clock).\n");
+		printf("   -reorder # :: let MPI renumber nodes so heavy links stay\n");
+		printf("              on one host (1 = on, default; 0 = off);\n");
+		printf("              the head node always stays node 0.\n");
+		printf("   -ensemble file :: run one simulation per line of a sweep\n");
+		printf("              file (seed, then a count per species) at once,\n");
+		printf("              each on its own group of nodes.\n");
+		printf("   -summary file :: write the ensemble summary to a file.\n");
+		printf("   -telemetry dir :: keep live stats of every node in dir\n");
+		printf("              (read them with ./monitor dir).\n");
+		printf("   -analytics # :: add up density, clustering and predator\n");
+		printf("              distance statistics on the nodes every #\n");
+		printf("              steps (0 = off, default).\n");
+		printf("   -analyticsfile file :: write them to file (default\n");
+		printf("              envsim.analytics).\n");
+		printf("   -counters # :: 1 = count cycles, instructions and cache and\n");
+		printf("              branch misses per phase on every node, printed\n");
+		printf("              at the end (default 0).\n");
+		printf("   -lod #  :: send density grids of #x# pixel cells to the\n");
+		printf("              display instead of every position (0 = off).\n");
+		printf("   -steps # :: stop the simulation after # steps (0 = no limit).\n");
+		printf("   -headless # :: 1 to run the head node without a window.\n");
+		printf("   -frames # :: export a frame every # steps (runs headless).\n");
+		printf("   -out prefix :: exported frames are named prefixNNNNNN.ppm.\n");
+		printf("   -video file :: export frames into one raw PPM stream instead.\n");
+		printf("   -ckpt # :: write a checkpoint every # steps (0 = off).\n");
+		printf("   -ckptfile file :: checkpoint file (default envsim.ckpt).\n");
+		printf("   -restart file :: resume from a checkpoint file.\n");
+		printf("   -record file :: record per-step statistics (appended to an\n");
+		printf("              earlier recording of the same kind).\n");
+		printf("   -snapshot # :: also record all positions every # steps.\n");
+		printf("   -replay file :: play back a recording (no MPI needed).\n");
+		printf("   -seek # :: start the replay at step #.\n");
+		printf("   -run # :: replay the #-th run of a recording that holds\n");
+		printf("              more than one (default 1).\n");
 		printf("You may use multiple initialization paramters simultaneously:\n");
 		printf("   (e.g.) $ ./envsim -plnt 50 -herb 100 -pred 20\n");
 }
@@ -43,7 +142,7 @@ int process_args(int argc, char **argv){
 	
 	// check for invalid argument formatting
 	if(argv[0][0] != '-' || strlen(argv[0]) < 2){
-		printf("Error: illegal argument: %s\n", argv[0][0]);
+		printf("Error: illegal argument: %s\n", argv[0]);
 		printf("Please use argument -h for help: $ ./envsim -h\n");
 		return 0;
 	}
@@ -63,7 +162,77 @@ int process_args(int argc, char **argv){
 			if(arg1[0] == '-'){
 				// get int from text (0 or less is invalid)
 				int count = atoi(arg2);
-				if(strlen(arg1) == 5 && (count > 0 || (strcmp(arg2, "0") == 0))){
+				
+				// arguments that take text instead of a number
+				if(strcmp(arg1, "-out") == 0){
+					// set prefix of exported frame files
+					frame_prefix = arg2;
+					printf("Frame file prefix: %s\n", arg2);
+				}
+				else if(strcmp(arg1, "-video") == 0){
+					// export frames into one raw PPM stream
+					video_path = arg2;
+					printf("Frame video stream: %s\n", arg2);
+				}
+				else if(strcmp(arg1, "-ckptfile") == 0){
+					// set checkpoint file
+					checkpoint_path = arg2;
+					printf("Checkpoint file: %s\n", arg2);
+				}
+				else if(strcmp(arg1, "-restart") == 0){
+					// restart from a checkpoint file
+					restart_path = arg2;
+					printf("Restart file: %s\n", arg2);
+				}
+				else if(strcmp(arg1, "-record") == 0){
+					// record statistics and snapshots to a file
+					record_path = arg2;
+					printf("Recording file: %s\n", arg2);
+				}
+				else if(strcmp(arg1, "-ensemble") == 0){
+					// run many simulations from a sweep file
+					ensemble_path = arg2;
+					printf("Ensemble sweep file: %s\n", arg2);
+				}
+				else if(strcmp(arg1, "-summary") == 0){
+					// write the ensemble summary to a file
+					summary_path = arg2;
+					printf("Ensemble summary file: %s\n", arg2);
+				}
+				else if(strcmp(arg1, "-world") == 0){
+					// set the world size (independent of the window)
+					if(sscanf(arg2, "%dx%d", &world_width, &world_height) != 2 ||
+							world_width < 100 || world_height < 100){
+						printf("Error: -world expects WIDTHxHEIGHT (100 or more each)\n");
+						return 0;
+					}
+					printf("World size: %dx%d\n", world_width, world_height);
+				}
+				else if(strcmp(arg1, "-scenario") == 0){
+					// read settings (and a food web) from a scenario file
+					scenario_path = arg2;
+					printf("Scenario file: %s\n", arg2);
+				}
+				else if(strcmp(arg1, "-foodweb") == 0){
+					// read the food web from a file
+					foodweb_path = arg2;
+				}
+				else if(strcmp(arg1, "-analyticsfile") == 0){
+					// set the analytics file
+					analytics_path = arg2;
+					printf("Analytics file: %s\n", arg2);
+				}
+				else if(strcmp(arg1, "-telemetry") == 0){
+					// publish live stats pages for the monitor
+					telemetry_dir = arg2;
+				}
+				else if(strcmp(arg1, "-replay") == 0){
+					// play back a recording instead of simulating
+					replay_path = arg2;
+					printf("Replaying: %s\n", arg2);
+				}
+				
+				else if(count > 0 || (strcmp(arg2, "0") == 0)){
 					if(strcmp(arg1, "-plnt") == 0){
 						// set plants
 						num_plants = count;
@@ -79,6 +248,117 @@ int process_args(int argc, char **argv){
 						num_predators = count;
 						printf("Initialized predators to: %d\n", count);
 					}
+					else if(strcmp(arg1, "-plntshards") == 0){
+						// set plant shards
+						requested_shards[PLANTS] = count;
+						printf("Plant shards: %d\n", count);
+					}
+					else if(strcmp(arg1, "-herbshards") == 0){
+						// set herbivore shards
+						requested_shards[HERBIVORES] = count;
+						printf("Herbivore shards: %d\n", count);
+					}
+					else if(strcmp(arg1, "-predshards") == 0){
+						// set predator shards
+						requested_shards[PREDATORS] = count;
+						printf("Predator shards: %d\n", count);
+					}
+					else if(strcmp(arg1, "-rebalance") == 0){
+						// set shard rebalancing interval
+						rebalance_interval = count;
+						printf("Rebalance shards every %d steps\n", count);
+					}
+					else if(strcmp(arg1, "-substeps") == 0 && count > 0){
+						// set steps moved between exchanges
+						substeps = count;
+						printf("Sub-steps per exchange: %d\n", count);
+					}
+					else if(strcmp(arg1, "-local") == 0){
+						// run everything in the head node's process
+						local_threads = count;
+						printf("Local engine threads: %d\n", count);
+					}
+					else if(strcmp(arg1, "-analytics") == 0){
+						// set the analytics interval
+						analytics_interval = count;
+						printf("Analytics every %d steps\n", count);
+					}
+					else if(strcmp(arg1, "-counters") == 0){
+						// count hardware events per phase
+						hardware_counters = count;
+						printf("Hardware counters: %s\n", count ? "on" : "off");
+					}
+					else if(strcmp(arg1, "-autotune") == 0){
+						// pick the fastest collision kernels as populations swing
+						collision_autotune = count;
+						printf("Collision autotuning: %s\n", count ? "on" : "off");
+					}
+					else if(strcmp(arg1, "-fused") == 0){
+						// fuse all interactions on one collision node
+						fused_collisions = count;
+						printf("Fused collisions: %s\n", count ? "on" : "off");
+					}
+					else if(strcmp(arg1, "-perceive") == 0){
+						// set perception radius
+						perception_radius = count;
+						printf("Perception radius: %d\n", count);
+					}
+					else if(strcmp(arg1, "-morton") == 0){
+						// set Morton sort interval
+						morton_interval = count;
+						printf("Morton sort every %d steps\n", count);
+					}
+					else if(strcmp(arg1, "-seed") == 0){
+						// set random seed
+						sim_seed = count;
+						printf("Random seed: %d\n", count);
+					}
+					else if(strcmp(arg1, "-reorder") == 0){
+						// node placement by the communication graph
+						topology_reorder = (count > 0);
+					}
+					else if(strcmp(arg1, "-lod") == 0){
+						// set level-of-detail cell size
+						lod_cell_size = count;
+						printf("Level-of-detail cell size: %d\n", count);
+					}
+					else if(strcmp(arg1, "-steps") == 0){
+						// set step limit
+						max_steps = count;
+						printf("Step limit: %d\n", count);
+					}
+					else if(strcmp(arg1, "-headless") == 0){
+						// run head node without a GLUT window
+						headless = (count > 0);
+						printf("Headless mode: %d\n", headless);
+					}
+					else if(strcmp(arg1, "-frames") == 0){
+						// export a frame every # steps (runs headless)
+						frame_interval = count;
+						if(count > 0)
+							headless = 1;
+						printf("Exporting a frame every %d steps\n", count);
+					}
+					else if(strcmp(arg1, "-ckpt") == 0){
+						// set checkpoint interval
+						checkpoint_interval = count;
+						printf("Checkpoint every %d steps\n", count);
+					}
+					else if(strcmp(arg1, "-snapshot") == 0){
+						// set recorded position snapshot interval
+						snapshot_interval = count;
+						printf("Recording positions every %d steps\n", count);
+					}
+					else if(strcmp(arg1, "-run") == 0){
+						// set replayed run
+						replay_start_run = count;
+						printf("Replaying run %d\n", count);
+					}
+					else if(strcmp(arg1, "-seek") == 0){
+						// set replay starting step
+						replay_start_step = count;
+						printf("Replay starts at step %d\n", count);
+					}
 				}
 			}
 			
@@ -96,7 +376,7 @@ int process_args(int argc, char **argv){
 /* MAIN: Program starts here */
 int main(int argc, char **argv){
 	// if arguments are given, process them
-	int arg_result;
+	int arg_result = 1;
 	if(argc > 1){
 		arg_result = process_args(argc-1, &argv[1]);
 	}
@@ -106,6 +386,12 @@ int main(int argc, char **argv){
 		exit(0);
 	}
 	
+	// replay a recording instead (runs without any worker nodes)
+	if(replay_path != NULL){
+		start_replay(argc, argv);
+		return 0;
+	}
+	
 	// call initialize simulation function, and run accordingly
 	start_sim(num_plants, num_herbivores, num_predators, argc, argv);
 }
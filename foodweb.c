@@ -0,0 +1,238 @@
+#include "foodweb.h"
+
+#include <string.h>
+#include <ctype.h>
+
+
+/* Sets up one species of the built-in web */
+void set_species(int type, char *name, int count, int speed, int regrow,
+		int feed_gain, int starve_at, int color){
+	Species *s = &species[type];
+	memset(s, 0, sizeof(Species));
+	strncpy(s->name, name, sizeof(s->name) - 1);
+	s->count = count;
+	s->speed = speed;
+	s->regrow = regrow;
+	s->feed_gain = feed_gain;
+	s->starve_at = starve_at;
+	s->color = color;
+}
+
+
+/* BUILT-IN WEB: plants, herbivores and predators (counts from the
+ *	command line, or the ensemble sweep).
+ */
+void default_foodweb(){
+	num_species = 3;
+	set_species(PLANTS, "plants", num_plants, 0, 30, 0, 0, 0x00FF00);
+	set_species(HERBIVORES, "herbivores", num_herbivores,
+		ORGANISM_MAX_SPEED, 0, 10, -100, 0x0000FF);
+	set_species(PREDATORS, "predators", num_predators,
+		ORGANISM_MAX_SPEED, 0, 20, -1000, 0xFF0000);
+
+	num_interactions = 2;
+	interactions[0].prey = PLANTS;
+	interactions[0].predator = HERBIVORES;
+	interactions[0].radius = PLANT_HERBIVORE_RADIUS;
+	interactions[1].prey = HERBIVORES;
+	interactions[1].predator = PREDATORS;
+	interactions[1].radius = HERBIVORE_PREDATOR_RADIUS;
+}
+
+
+/* Type of the species with the given name (-1 if there is none) */
+int find_species(char *name){
+	int t;
+	for(t=0; t<num_species; t++){
+		if(strcmp(species[t].name, name) == 0)
+			return t;
+	}
+	return -1;
+}
+
+
+/* Index of the interaction where predator eats prey (-1 if none) */
+int find_interaction(int predator, int prey){
+	int i;
+	for(i=0; i<num_interactions; i++){
+		if(interactions[i].predator == predator && interactions[i].prey == prey)
+			return i;
+	}
+	return -1;
+}
+
+
+/* Reads a food web file (see foodweb.h). Returns 0 (after printing
+ *	what is wrong) if it cannot be used.
+ */
+int read_foodweb(char *path){
+	FILE *file = fopen(path, "r");
+	if(file == NULL){
+		printf("Error: could not open food web %s\n", path);
+		return 0;
+	}
+	num_species = 0;
+	num_interactions = 0;
+	char line[256];
+	int line_number = 0;
+	int valid = 1;
+	while(valid && fgets(line, sizeof(line), file) != NULL){
+		line_number++;
+		char *comment = strchr(line, '#');
+		if(comment != NULL)
+			*comment = '\0';
+		char keyword[16], name[64], other[64];
+		if(sscanf(line, "%15s", keyword) != 1)
+			continue; // blank line
+		if(keyword[0] == '-')
+			continue; // setting of a scenario (see scenario.h)
+
+		if(strcmp(keyword, "species") == 0){
+			int count, speed, regrow, feed_gain, starve_at;
+			unsigned int color;
+			int shards = 0;
+			int read = sscanf(line, "%*s %63s %d %d %d %d %d %x %d", name,
+				&count, &speed, &regrow, &feed_gain, &starve_at, &color, &shards);
+			if(read < 7 || count < 0 || speed < 0 || regrow < 0){
+				printf("Error: %s line %d: expected species <name> <count> ",
+					path, line_number);
+				printf("<speed> <regrow> <feed_gain> <starve_at> <color> [shards]\n");
+				valid = 0;
+			}
+			else if(num_species == NUMBER_OF_ORGANISMS){
+				printf("Error: %s: more than %d species\n", path,
+					NUMBER_OF_ORGANISMS);
+				valid = 0;
+			}
+			else if(strlen(name) >= sizeof(species[0].name) ||
+					find_species(name) >= 0){
+				printf("Error: %s line %d: species name %s is too long ",
+					path, line_number, name);
+				printf("or already used\n");
+				valid = 0;
+			}
+			else{
+				set_species(num_species, name, count, speed, regrow,
+					feed_gain, starve_at, color);
+				// shards on the command line come first
+				if(shards > 0 && requested_shards[num_species] == 0)
+					requested_shards[num_species] = shards;
+				num_species++;
+			}
+		}
+		else if(strcmp(keyword, "eats") == 0){
+			int radius;
+			int read = sscanf(line, "%*s %63s %63s %d", name, other, &radius);
+			int predator = (read == 3) ? find_species(name) : -1;
+			int prey = (read == 3) ? find_species(other) : -1;
+			if(predator < 0 || prey < 0 || predator == prey || radius < 0){
+				printf("Error: %s line %d: expected eats <predator> <prey> ",
+					path, line_number);
+				printf("<radius>, with two different species named before\n");
+				valid = 0;
+			}
+			else if(find_interaction(predator, prey) >= 0){
+				printf("Error: %s line %d: %s already eat %s\n",
+					path, line_number, name, other);
+				valid = 0;
+			}
+			else if(num_interactions == MAX_INTERACTIONS){
+				printf("Error: %s: more than %d interactions\n", path,
+					MAX_INTERACTIONS);
+				valid = 0;
+			}
+			else{
+				Interaction *interaction = &interactions[num_interactions++];
+				interaction->prey = prey;
+				interaction->predator = predator;
+				interaction->radius = radius;
+			}
+		}
+		else{
+			printf("Error: %s line %d: unknown keyword %s\n",
+				path, line_number, keyword);
+			valid = 0;
+		}
+	}
+	fclose(file);
+
+	if(valid && num_species == 0){
+		printf("Error: no species in food web %s\n", path);
+		valid = 0;
+	}
+	return valid;
+}
+
+
+/* ALL NODES (right after MPI_Init, on every node of the job): node 0
+ *	reads the food web (or builds the built-in one) and sends it to
+ *	every node.
+ */
+void init_foodweb(){
+	int world_rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+
+	int valid = 1;
+	if(world_rank == 0){
+		if(foodweb_path != NULL)
+			valid = read_foodweb(foodweb_path);
+		else
+			default_foodweb();
+	}
+	MPI_Bcast(&valid, 1, MPI_INT, 0, MPI_COMM_WORLD);
+	if(!valid)
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	MPI_Bcast(&num_species, 1, MPI_INT, 0, MPI_COMM_WORLD);
+	MPI_Bcast(species, sizeof(species), MPI_BYTE, 0, MPI_COMM_WORLD);
+	MPI_Bcast(&num_interactions, 1, MPI_INT, 0, MPI_COMM_WORLD);
+	MPI_Bcast(interactions, sizeof(interactions), MPI_BYTE,
+		0, MPI_COMM_WORLD);
+	MPI_Bcast(requested_shards, NUMBER_OF_ORGANISMS, MPI_INT,
+		0, MPI_COMM_WORLD);
+
+	int i;
+	for(i=0; i<num_interactions; i++){
+		species[interactions[i].predator].eats = 1;
+	}
+	if(world_rank == 0 && foodweb_path != NULL){
+		printf("Food web %s: %d species, %d interactions.\n",
+			foodweb_path, num_species, num_interactions);
+	}
+}
+
+
+/* PERCEPTION: whether the collision node of interaction i sends
+ *	ghosts (only between species that both move).
+ */
+int interaction_ghosts(int i){
+	return perception_radius > 0 &&
+		species[interactions[i].prey].speed > 0 &&
+		species[interactions[i].predator].speed > 0;
+}
+
+
+/* Whether the given collision node runs any interaction of the given
+ *	species (and so needs its positions every exchange).
+ */
+int node_uses_species(int node, int type){
+	int i;
+	for(i=0; i<num_interactions; i++){
+		if(interactions[i].node == node && (interactions[i].prey == type ||
+				interactions[i].predator == type)){
+			return 1;
+		}
+	}
+	return 0;
+}
+
+
+/* Prints the given number of organisms of every species on one line */
+void print_populations(int counts[]){
+	printf(":::::");
+	int t;
+	for(t=0; t<num_species; t++){
+		printf("%s%c%s: %d", t ? "     " : " ",
+			toupper(species[t].name[0]), &species[t].name[1], counts[t]);
+	}
+	printf("\n");
+}
@@ -0,0 +1,80 @@
+#ifndef FOODWEB_H
+#define FOODWEB_H
+
+
+/* Contains functions for global operations */
+#include "global.h"
+
+
+/* FOOD WEB:
+ *	The organism types (species) of the simulation, and which species
+ *	eat which (interactions). Every node holds the same copy: node 0
+ *	reads it (or builds the built-in web of plants, herbivores and
+ *	predators) and sends it to all others before the layout is made.
+ *
+ *	Species that eat nothing regrow (one new organism per regrow alive,
+ *	every step) and never starve; species that eat gain feed_gain food
+ *	per prey, lose 1 every step, starve below starve_at and reproduce
+ *	when they have 10 or more. Species with speed 0 never move.
+ *
+ *	File format (anything after a '#' is a comment; lines starting
+ *	with '-' are left to scenario files, see scenario.h):
+ *		species <name> <count> <speed> <regrow> <feed_gain> <starve_at>
+ *			<color RRGGBB> [shards]
+ *		eats <predator> <prey> <radius>
+ *	e.g. the built-in web:
+ *		species plants     100000  0 30  0     0 00FF00
+ *		species herbivores   2000 10  0 10  -100 0000FF
+ *		species predators     450 10  0 20 -1000 FF0000
+ *		eats herbivores plants 2
+ *		eats predators herbivores 1
+ */
+
+// most interactions in a food web (species: NUMBER_OF_ORGANISMS)
+#define MAX_INTERACTIONS 32
+
+// food an organism needs to reproduce
+#define REPRODUCE_FEEDS 10
+
+
+typedef struct {
+	char name[16];
+	int count; // starting (and most) organisms
+	int speed; // fastest velocity component (0 = never moves)
+	int regrow; // one new organism per regrow alive, each step (0 = never)
+	int feed_gain; // food gained per prey eaten
+	int starve_at; // starves if its food drops below this
+	int color; // 0xRRGGBB
+	int eats; // 1 if it is the predator of any interaction (set on load)
+} Species;
+
+typedef struct {
+	int prey;
+	int predator;
+	int radius; // collision distance (in pixels, along both axes)
+	int node; // collision node it runs on (set by init_layout)
+} Interaction;
+
+
+// file to read the food web from (NULL = built-in web)
+char *foodweb_path;
+
+// the species and interactions of the simulation
+int num_species;
+Species species[NUMBER_OF_ORGANISMS];
+int num_interactions;
+Interaction interactions[MAX_INTERACTIONS];
+
+
+/* Food web methods */
+void init_foodweb();
+void default_foodweb();
+int read_foodweb(char *path);
+int find_species(char *name);
+int find_interaction(int predator, int prey);
+int interaction_ghosts(int i);
+int node_uses_species(int node, int type);
+void print_populations(int counts[]);
+
+
+#endif
@@ -10,22 +10,33 @@
 #include <time.h>
 
 
-// include all subsystem files
-#include "mpi_system.h"
-#include "display.h"
+// most organism types (species) in a food web (see foodweb.h)
+#define NUMBER_OF_ORGANISMS 8
 
-
-// Number of organisms static (may be adjusted with more added organisms)
-#define NUMBER_OF_ORGANISMS 3
-
-// organism type values
+// organism type values of the built-in food web
 #define PLANTS 0
 #define HERBIVORES 1
 #define PREDATORS 2
 
-// collision processor nodes
-#define COLL_PLANTS_HERBIVORES 4
-#define COLL_HERBIVORES_PREDATORS 5
+
+// include all subsystem files
+#include "mpi_system.h"
+#include "display.h"
+#include "render.h"
+#include "checkpoint.h"
+#include "recorder.h"
+#include "replay.h"
+#include "ensemble.h"
+#include "foodweb.h"
+#include "neighbour.h"
+#include "scenario.h"
+#include "telemetry.h"
+#include "counters.h"
+#include "analytics.h"
+#include "morton.h"
+#include "organism.h"
+#include "collision.h"
+#include "local.h"
 
 
 /* WORKER NODE VARIABLES:
@@ -35,21 +46,27 @@
 int organism_type;
 int num_organisms;
 
+// starting organisms of the built-in food web (see foodweb.h)
 int num_plants;
 int num_herbivores;
 int num_predators;
 
+// random seed of the organism nodes, each adding its rank (0 = seed
+//	from the clock)
+int sim_seed;
 
-// number of each type of active organisms located on the screen
-//	(used by calculation processors, including display and collisions)
-int plant_loc_count;
-int herbivore_loc_count;
-int predator_loc_count;
+
+// number of active organisms of each type located on the screen
+//	(used by the head node, for display, recording and replay)
+int organism_loc_count[NUMBER_OF_ORGANISMS];
 
 
 /* starts and sorts out all subsystems, and initializes display on head node */
 void start_sim(int plants, int herbivores, int predators, int argc, char **argv);
 
+/* starting (maximum) number of organisms of the given type */
+int num_organisms_of(int type);
+
 /* stop all subsystems, and quit the main program */
 void terminate();
 
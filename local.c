@@ -0,0 +1,475 @@
+#include "local.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+
+// the populations, and the random number state of each (seeded as on
+//	the organism node of the species)
+Population local_pops[NUMBER_OF_ORGANISMS];
+char local_random[NUMBER_OF_ORGANISMS][128];
+
+// reports of the last exchange (merged over every interaction, as on
+//	the organism nodes)
+char *local_deaths[NUMBER_OF_ORGANISMS];
+int *local_feeds[NUMBER_OF_ORGANISMS];
+
+// statistics already reported (births, eaten, starved)
+int local_stats_sent[NUMBER_OF_ORGANISMS][3];
+
+// SUB-STEPPING: starting states of the moving species, and the paths
+//	of every species
+int *local_states[NUMBER_OF_ORGANISMS];
+Paths local_paths[NUMBER_OF_ORGANISMS];
+
+// PERCEPTION: positions after the last exchange (ghosts), and the
+//	ghosts each species flees from (threats) and chases (food)
+int *local_ghosts[NUMBER_OF_ORGANISMS];
+int local_num_ghosts[NUMBER_OF_ORGANISMS];
+int *local_threats[NUMBER_OF_ORGANISMS];
+int *local_food[NUMBER_OF_ORGANISMS];
+NeighbourGrid local_threat_grids[NUMBER_OF_ORGANISMS];
+NeighbourGrid local_food_grids[NUMBER_OF_ORGANISMS];
+
+// grid of every interaction's predators, each thread's feeds, and the
+//	deaths of one interaction (sub-stepping)
+NeighbourGrid local_predator_grids[MAX_INTERACTIONS];
+int *local_thread_feeds[LOCAL_MAX_THREADS];
+char *local_task_deaths;
+
+// steps simulated so far
+int local_step_count;
+
+
+/********************** THREAD POOL ***********************/
+/* Threads 1 and up wait for a job, each runs its slice of the
+ *	organisms, and the head node's thread (thread 0) runs the first
+ *	slice and waits for the others.
+ */
+pthread_t local_pool[LOCAL_MAX_THREADS];
+pthread_mutex_t local_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t local_start = PTHREAD_COND_INITIALIZER;
+pthread_cond_t local_done = PTHREAD_COND_INITIALIZER;
+int local_generation = 0; // jobs started so far
+int local_busy = 0; // threads still working on the current job
+LocalJob local_job;
+void *local_job_arg;
+int local_job_count;
+
+/* Runs the given thread's slice of the current job */
+void local_slice(int thread){
+	int first = (int)((long long)local_job_count * thread / local_threads);
+	int last = (int)((long long)local_job_count * (thread + 1) / local_threads);
+	if(first < last)
+		local_job(local_job_arg, first, last, thread);
+}
+
+void *local_worker(void *arg){
+	int thread = (int)(long)arg;
+	int seen = 0;
+	while(1){
+		pthread_mutex_lock(&local_lock);
+		while(local_generation == seen){
+			pthread_cond_wait(&local_start, &local_lock);
+		}
+		seen = local_generation;
+		pthread_mutex_unlock(&local_lock);
+
+		local_slice(thread);
+
+		pthread_mutex_lock(&local_lock);
+		local_busy--;
+		if(local_busy == 0)
+			pthread_cond_signal(&local_done);
+		pthread_mutex_unlock(&local_lock);
+	}
+	return NULL;
+}
+
+/* Runs job over count organisms, split evenly over the threads, and
+ *	returns once every slice is done.
+ */
+void local_parallel(LocalJob job, void *arg, int count){
+	if(local_threads == 1){
+		if(count > 0)
+			job(arg, 0, count, 0);
+		return;
+	}
+	pthread_mutex_lock(&local_lock);
+	local_job = job;
+	local_job_arg = arg;
+	local_job_count = count;
+	local_busy = local_threads - 1;
+	local_generation++;
+	pthread_cond_broadcast(&local_start);
+	pthread_mutex_unlock(&local_lock);
+
+	local_slice(0);
+
+	pthread_mutex_lock(&local_lock);
+	while(local_busy > 0){
+		pthread_cond_wait(&local_done, &local_lock);
+	}
+	pthread_mutex_unlock(&local_lock);
+}
+
+
+/************************* JOBS **************************/
+
+/* Opens the hardware counters of every pool thread (count = threads,
+ *	so each thread gets one; the head node's are open already)
+ */
+void counters_job(void *arg, int first, int last, int thread){
+	if(thread > 0)
+		counters_thread(thread);
+}
+
+
+/* The organisms from first on of a population, as a population of
+ *	their own (sharing its arrays)
+ */
+Population population_slice(Population *pop, int first, int last){
+	Population part = *pop;
+	part.count = last - first;
+	part.positions = &pop->positions[2*first];
+	part.posF = &pop->posF[2*first];
+	part.x_velocity = &pop->x_velocity[first];
+	part.y_velocity = &pop->y_velocity[first];
+	part.total_feeds = &pop->total_feeds[first];
+	return part;
+}
+
+/* The paths from organism first on */
+Paths paths_slice(Paths *paths, int first){
+	Paths part = *paths;
+	part.points = &paths->points[first * paths->length * 2];
+	part.boxes = &paths->boxes[first * 4];
+	return part;
+}
+
+
+/* MOVE: steer (if perceiving), keep the starting states and move every
+ *	organism of one species, and replay the paths (if sub-stepping)
+ */
+typedef struct {
+	Population *pop;
+	NeighbourGrid *threats;
+	NeighbourGrid *food;
+	int perceiving;
+} MoveWork;
+
+void move_job(void *arg, int first, int last, int thread){
+	MoveWork *work = (MoveWork*)arg;
+	int type = work->pop->type;
+	Population part = population_slice(work->pop, first, last);
+	if(work->perceiving)
+		steer_population(&part, work->threats, work->food);
+	int *data = part.positions;
+	int stride = collision_stride(type);
+	if(stride == 4){
+		data = &local_states[type][4*first];
+		population_states(&part, data);
+	}
+	int k;
+	for(k=0; k<substeps; k++){
+		move_population(&part);
+	}
+	if(substeps > 1){
+		Paths paths = paths_slice(&local_paths[type], first);
+		expand_paths(&paths, data, stride, part.count, substeps);
+	}
+}
+
+
+/* COLLIDE: every prey of one interaction is eaten by the first
+ *	predator (in order) within the radius, as in collide_brute (with
+ *	a grid of the predators), or along the swept paths when
+ *	sub-stepping, as in collide_swept. Feeds go to each thread's own
+ *	buffer, and are added up afterwards.
+ */
+typedef struct {
+	Interaction *task;
+	NeighbourGrid *grid;
+} CollideWork;
+
+void collide_job(void *arg, int first, int last, int thread){
+	CollideWork *work = (CollideWork*)arg;
+	Interaction *task = work->task;
+	char *deaths = local_deaths[task->prey];
+	int *feeds = local_thread_feeds[thread];
+	int radius = task->radius;
+	int i;
+
+	if(substeps > 1){
+		Paths prey = paths_slice(&local_paths[task->prey], first);
+		memset(&local_task_deaths[first], 0, last - first);
+		collide_swept(&prey, last - first, &local_paths[task->predator],
+			local_pops[task->predator].count, substeps, radius,
+			&local_task_deaths[first], feeds);
+		for(i=first; i<last; i++){
+			deaths[i] |= local_task_deaths[i];
+		}
+		return;
+	}
+
+	collide_grid(work->grid, local_pops[task->prey].positions,
+		local_pops[task->predator].positions, radius, first, last,
+		deaths, feeds);
+}
+
+/* Adds every thread's feeds into the given ones (and clears them) */
+void feeds_job(void *arg, int first, int last, int thread){
+	int *feeds = (int*)arg;
+	int t, j;
+	for(t=0; t<local_threads; t++){
+		int *part = local_thread_feeds[t];
+		for(j=first; j<last; j++){
+			feeds[j] += part[j];
+			part[j] = 0;
+		}
+	}
+}
+
+
+/************************ ENGINE *************************/
+
+/* Whether the positions of the given species are sent as ghosts */
+int local_keeps_ghosts(int type){
+	int i;
+	for(i=0; i<num_interactions; i++){
+		if(interaction_ghosts(i) && (interactions[i].prey == type ||
+				interactions[i].predator == type))
+			return 1;
+	}
+	return 0;
+}
+
+
+/* HEAD NODE: create every population (with the random numbers of its
+ *	organism node), the report and ghost buffers, and the thread pool.
+ */
+void init_local(){
+	if(local_threads > LOCAL_MAX_THREADS)
+		local_threads = LOCAL_MAX_THREADS;
+	unsigned int seed = sim_seed ? (unsigned int)sim_seed : (unsigned int)time(NULL);
+	int largest = 0;
+	int t, i;
+	for(t=0; t<num_species; t++){
+		int count = species[t].count;
+		if(count > largest)
+			largest = count;
+
+		// organism node t + 1 seeds with seed + its rank
+		initstate(seed + t + 1, local_random[t], sizeof(local_random[t]));
+		init_population(&local_pops[t], t, count, count, count);
+		local_deaths[t] = (char*)(calloc(count + 1, sizeof(char)));
+		local_feeds[t] = (int*)(calloc(count + 1, sizeof(int)));
+		memset(local_stats_sent[t], 0, sizeof(local_stats_sent[t]));
+
+		local_states[t] = NULL;
+		if(collision_stride(t) == 4)
+			local_states[t] = (int*)(malloc((count + 1) * 4 * sizeof(int)));
+		if(substeps > 1){
+			local_paths[t].length = (collision_stride(t) == 4) ? substeps + 1 : 1;
+			local_paths[t].points = (int*)(malloc(
+				(count + 1) * local_paths[t].length * 2 * sizeof(int)));
+			local_paths[t].boxes = (int*)(malloc((count + 1) * 4 * sizeof(int)));
+		}
+
+		local_ghosts[t] = NULL;
+		local_num_ghosts[t] = 0;
+		if(local_keeps_ghosts(t))
+			local_ghosts[t] = (int*)(malloc((count + 1) * 2 * sizeof(int)));
+	}
+
+	// ghosts each species steers by (from every interaction, as on the
+	//	organism nodes)
+	for(t=0; t<num_species; t++){
+		int threat_capacity = 0;
+		int food_capacity = 0;
+		for(i=0; i<num_interactions; i++){
+			if(!interaction_ghosts(i))
+				continue;
+			if(interactions[i].prey == t)
+				threat_capacity += num_organisms_of(interactions[i].predator);
+			else if(interactions[i].predator == t)
+				food_capacity += num_organisms_of(interactions[i].prey);
+		}
+		local_threats[t] = NULL;
+		local_food[t] = NULL;
+		if(threat_capacity > 0){
+			local_threats[t] = (int*)(malloc((threat_capacity + 1) * 2 * sizeof(int)));
+			init_neighbour_grid(&local_threat_grids[t], perception_radius,
+				threat_capacity);
+		}
+		if(food_capacity > 0){
+			local_food[t] = (int*)(malloc((food_capacity + 1) * 2 * sizeof(int)));
+			init_neighbour_grid(&local_food_grids[t], perception_radius,
+				food_capacity);
+		}
+	}
+
+	for(i=0; i<num_interactions; i++){
+		init_neighbour_grid(&local_predator_grids[i],
+			interactions[i].radius > 1 ? interactions[i].radius : 1,
+			num_organisms_of(interactions[i].predator));
+	}
+	local_task_deaths = (char*)(malloc(largest + 1));
+	for(t=0; t<local_threads; t++){
+		local_thread_feeds[t] = (int*)(calloc(largest + 1, sizeof(int)));
+	}
+	for(t=1; t<local_threads; t++){
+		pthread_create(&local_pool[t], NULL, local_worker, (void*)(long)t);
+	}
+	if(hardware_counters)
+		local_parallel(counters_job, NULL, local_threads);
+	local_step_count = 0;
+	printf("Local engine running with %d threads.\n", local_threads);
+}
+
+
+/* HEAD NODE: one exchange of every organism node and collision node:
+ *	apply the last reports, move, and check every interaction.
+ */
+void local_step(){
+	int t, i;
+
+	// apply the reports of the last exchange (one species after the
+	//	other, each drawing from its own random numbers)
+	for(t=0; t<num_species; t++){
+		setstate(local_random[t]);
+		update_population(&local_pops[t], local_feeds[t], local_deaths[t],
+			substeps);
+	}
+	telemetry_phase(PHASE_UPDATE);
+
+	// keep organisms that are close in the window close in memory
+	local_step_count += substeps;
+	for(t=0; t<num_species; t++){
+		if(morton_interval > 0 && local_step_count / morton_interval !=
+				(local_step_count - substeps) / morton_interval){
+			morton_sort_population(&local_pops[t]);
+		}
+	}
+
+	// move every species (steering by the ghosts of the last exchange)
+	for(t=0; t<num_species; t++){
+		MoveWork work;
+		work.pop = &local_pops[t];
+		work.threats = NULL;
+		work.food = NULL;
+		work.perceiving = (local_threats[t] != NULL || local_food[t] != NULL);
+		if(work.perceiving){
+			int num_threats = 0;
+			int num_food = 0;
+			for(i=0; i<num_interactions; i++){
+				if(!interaction_ghosts(i))
+					continue;
+				int other;
+				if(interactions[i].prey == t){
+					other = interactions[i].predator;
+					memcpy(&local_threats[t][2*num_threats], local_ghosts[other],
+						local_num_ghosts[other] * 2 * sizeof(int));
+					num_threats += local_num_ghosts[other];
+				}
+				else if(interactions[i].predator == t){
+					other = interactions[i].prey;
+					memcpy(&local_food[t][2*num_food], local_ghosts[other],
+						local_num_ghosts[other] * 2 * sizeof(int));
+					num_food += local_num_ghosts[other];
+				}
+			}
+			if(local_threats[t] != NULL){
+				build_neighbour_grid(&local_threat_grids[t], local_threats[t],
+					num_threats);
+				work.threats = &local_threat_grids[t];
+			}
+			if(local_food[t] != NULL){
+				build_neighbour_grid(&local_food_grids[t], local_food[t], num_food);
+				work.food = &local_food_grids[t];
+			}
+		}
+		local_parallel(move_job, &work, local_pops[t].count);
+	}
+	telemetry_phase(PHASE_MOVE);
+
+	// check every interaction
+	for(t=0; t<num_species; t++){
+		memset(local_deaths[t], 0, local_pops[t].count * sizeof(char));
+		memset(local_feeds[t], 0, local_pops[t].count * sizeof(int));
+	}
+	for(i=0; i<num_interactions; i++){
+		CollideWork work;
+		work.task = &interactions[i];
+		work.grid = &local_predator_grids[i];
+		Population *predators = &local_pops[interactions[i].predator];
+		if(substeps == 1){
+			build_neighbour_grid(work.grid, predators->positions,
+				predators->count);
+		}
+		local_parallel(collide_job, &work, local_pops[interactions[i].prey].count);
+		local_parallel(feeds_job, local_feeds[interactions[i].predator],
+			predators->count);
+	}
+
+	// keep where everything ended up, as the next ghosts
+	for(t=0; t<num_species; t++){
+		if(local_ghosts[t] == NULL)
+			continue;
+		memcpy(local_ghosts[t], local_pops[t].positions,
+			local_pops[t].count * 2 * sizeof(int));
+		local_num_ghosts[t] = local_pops[t].count;
+	}
+	telemetry_phase(PHASE_COLLIDE);
+}
+
+
+/* HEAD NODE: fill the display buffers straight from the populations,
+ *	as the reports of the organism nodes would (see receive_reports),
+ *	and the statistics since the last report into stats.
+ */
+void local_report(int stats[][3]){
+	memset(stats, 0, NUMBER_OF_ORGANISMS * sizeof(stats[0]));
+	float *locs = organism_loc_block;
+	int t;
+	for(t=0; t<num_species; t++){
+		Population *pop = &local_pops[t];
+		organism_loc_count[t] = pop->count;
+		stats[t][0] = pop->num_births - local_stats_sent[t][0];
+		stats[t][1] = pop->num_eaten - local_stats_sent[t][1];
+		stats[t][2] = pop->num_starved - local_stats_sent[t][2];
+		local_stats_sent[t][0] = pop->num_births;
+		local_stats_sent[t][1] = pop->num_eaten;
+		local_stats_sent[t][2] = pop->num_starved;
+
+		if(lod_cell_size > 0){
+			organism_density[t] = &organism_density_block[t * lod_cell_count()];
+			rasterize_density(pop->positions, pop->count, organism_density[t]);
+			organism_view_count[t] = 0;
+		}
+		else{
+			organism_locs[t] = locs;
+			organism_view_count[t] = view_positions(pop->positions, pop->count,
+				locs);
+			locs += 2 * organism_view_count[t];
+		}
+	}
+}
+
+
+/* HEAD NODE (when analysing): add up the analytics of every species
+ *	and interaction, as the organism and collision nodes would.
+ */
+void local_analytics(){
+	int t, i;
+	for(t=0; t<num_species; t++){
+		analytics_species(t, local_pops[t].positions, local_pops[t].count);
+	}
+	for(i=0; i<num_interactions; i++){
+		Population *prey = &local_pops[interactions[i].prey];
+		Population *predators = &local_pops[interactions[i].predator];
+		analytics_interaction(i, prey->positions, prey->count,
+			predators->positions, predators->count);
+	}
+}
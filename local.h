@@ -0,0 +1,43 @@
+#ifndef LOCAL_H
+#define LOCAL_H
+
+
+/* Contains functions for global operations */
+#include "global.h"
+
+
+/* LOCAL ENGINE:
+ *	Runs the whole simulation inside the head node's process, with no
+ *	MPI messages at all: one population per species (as on an unsharded
+ *	organism node, with the same random numbers), and every interaction
+ *	checked as a collision node would, each exchange. The display reads
+ *	the populations straight from the engine.
+ *	A pool of local_threads threads (the head node's own included)
+ *	moves the organisms and checks the collisions, each thread taking
+ *	one slice of the organisms; births and deaths draw random numbers,
+ *	so they are applied one species after the other.
+ *	With the same seed, a run matches the distributed run on
+ *	1 + species + interactions nodes (no shards), so it doubles as a
+ *	reference for the distributed mode. Checkpoints are not supported.
+ */
+
+// threads of the local engine (0 = distributed mode; a job started as
+//	a single process uses one per core)
+int local_threads;
+
+// most threads in the pool
+#define LOCAL_MAX_THREADS 64
+
+// work of one parallel job on organisms [first, last), by thread
+typedef void (*LocalJob)(void *arg, int first, int last, int thread);
+
+
+/* Local engine methods */
+void init_local();
+void local_step();
+void local_report(int stats[][3]);
+void local_parallel(LocalJob job, void *arg, int count);
+void local_analytics();
+
+
+#endif
@@ -0,0 +1,225 @@
+/* TELEMETRY MONITOR:
+ *	Shows the stats pages the nodes of a running simulation publish
+ *	(envsim -telemetry dir), refreshed every interval. Pages are only
+ *	ever read, under their seqlock, so the nodes never wait on it.
+ *
+ *	Usage: ./monitor dir [-interval ms] [-once]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "telemetry.h"
+
+
+// most pages shown
+#define MAX_PAGES 1024
+
+// a node that has not updated its page for this long is stalled
+#define STALLED_SECONDS 5.0
+
+// names of node roles (ROLE_* in mpi_system.h)
+char *role_names[] = { "head", "organism", "collision", "unused" };
+
+
+// step and update time of every page at the last refresh (for rates)
+char *last_names[MAX_PAGES];
+int last_steps[MAX_PAGES];
+double last_updates[MAX_PAGES];
+int num_last = 0;
+
+
+/* Wall clock time in seconds */
+double monitor_clock(){
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return now.tv_sec + now.tv_usec / 1000000.0;
+}
+
+
+/* Copies a consistent snapshot of page into copy: retries while the
+ *	writer is in the middle of an update. Returns 0 if no consistent
+ *	copy could be made.
+ */
+int read_page(TelemetryPage *page, TelemetryPage *copy){
+	int tries;
+	for(tries=0; tries<1000; tries++){
+		unsigned int before = __atomic_load_n(&page->sequence, __ATOMIC_ACQUIRE);
+		if(before & 1){
+			sched_yield();
+			continue;
+		}
+		memcpy(copy, page, sizeof(TelemetryPage));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		unsigned int after = __atomic_load_n(&page->sequence, __ATOMIC_RELAXED);
+		if(before == after)
+			return 1;
+	}
+	return 0;
+}
+
+
+/* Maps the stats page at path and reads it into copy.
+ *	Returns 0 if it is not a (complete) stats page.
+ */
+int load_page(char *path, TelemetryPage *copy){
+	int file = open(path, O_RDONLY);
+	if(file < 0)
+		return 0;
+	struct stat info;
+	if(fstat(file, &info) != 0 || info.st_size < sizeof(TelemetryPage)){
+		close(file);
+		return 0;
+	}
+	void *mapped = mmap(NULL, sizeof(TelemetryPage), PROT_READ, MAP_SHARED,
+		file, 0);
+	close(file);
+	if(mapped == MAP_FAILED)
+		return 0;
+	int ok = read_page((TelemetryPage*)mapped, copy);
+	munmap(mapped, sizeof(TelemetryPage));
+	return ok && copy->magic == TELEMETRY_MAGIC &&
+		copy->version == TELEMETRY_VERSION;
+}
+
+
+/* Steps per second of the named page since the last refresh (and
+ *	remembers its current step).
+ */
+double step_rate(char *name, TelemetryPage *page){
+	int i;
+	for(i=0; i<num_last; i++){
+		if(strcmp(last_names[i], name) == 0)
+			break;
+	}
+	if(i == num_last){
+		if(num_last == MAX_PAGES)
+			return 0;
+		last_names[num_last++] = strdup(name);
+		last_updates[i] = 0;
+	}
+	double rate = 0;
+	double elapsed = page->updated - last_updates[i];
+	if(last_updates[i] > 0 && elapsed > 0)
+		rate = (page->step - last_steps[i]) / elapsed;
+	last_steps[i] = page->step;
+	last_updates[i] = page->updated;
+	return rate;
+}
+
+
+/* Only stats page files */
+int is_page(const struct dirent *entry){
+	int length = strlen(entry->d_name);
+	return length > 6 && strcmp(&entry->d_name[length - 6], ".stats") == 0;
+}
+
+
+/* Prints one line per stats page in dir. Returns the number shown. */
+int show_pages(char *dir){
+	struct dirent **entries;
+	int count = scandir(dir, &entries, is_page, alphasort);
+	if(count < 0){
+		printf("Error: could not read directory %s\n", dir);
+		return -1;
+	}
+
+	double now = monitor_clock();
+	printf("%-18s %-14s %8s %8s %9s %9s %9s %9s %8s  %s\n",
+		"page", "role", "step", "steps/s", "organisms", "births", "deaths",
+		"sent MB", "messages", "recv/update/move/collide/send/display %");
+	int shown = 0;
+	int i, p;
+	for(i=0; i<count; i++){
+		char *name = entries[i]->d_name;
+		char *path = (char*)(malloc(strlen(dir) + strlen(name) + 2));
+		sprintf(path, "%s/%s", dir, name);
+		TelemetryPage page;
+		int ok = load_page(path, &page);
+		free(path);
+		if(!ok){
+			free(entries[i]);
+			continue;
+		}
+
+		char role[32];
+		if(page.role == 1)
+			sprintf(role, "%.15s/%d", page.type_name, page.shard);
+		else if(page.role >= 0 && page.role < 4)
+			sprintf(role, "%s", role_names[page.role]);
+		else
+			sprintf(role, "?");
+
+		double total = 0;
+		for(p=0; p<NUM_PHASES; p++){
+			total += page.phase_seconds[p];
+		}
+
+		char *name_end = strstr(name, ".stats");
+		*name_end = '\0';
+		printf("%-18s %-14s %8d %8.1f %9d %9lld %9lld %9.1f %8lld ",
+			name, role, page.step, step_rate(name, &page), page.population,
+			page.births, page.deaths, page.bytes_sent / 1048576.0,
+			page.messages_sent);
+		for(p=0; p<NUM_PHASES; p++){
+			printf("%s%3.0f", p ? "/" : " ",
+				total > 0 ? 100 * page.phase_seconds[p] / total : 0.0);
+		}
+		if(page.done)
+			printf("  done");
+		else if(now - page.updated > STALLED_SECONDS)
+			printf("  stalled %.0fs", now - page.updated);
+		printf("\n");
+		shown++;
+		free(entries[i]);
+	}
+	free(entries);
+	if(shown == 0)
+		printf("(no stats pages in %s yet)\n", dir);
+	return shown;
+}
+
+
+int main(int argc, char **argv){
+	if(argc < 2){
+		printf("Usage: %s dir [-interval ms] [-once]\n", argv[0]);
+		printf("   dir :: directory given to envsim -telemetry\n");
+		printf("   -interval ms :: refresh every ms milliseconds (default 1000)\n");
+		printf("   -once :: print the pages once and exit\n");
+		return 1;
+	}
+	char *dir = argv[1];
+	int interval = 1000;
+	int once = 0;
+	int i;
+	for(i=2; i<argc; i++){
+		if(strcmp(argv[i], "-once") == 0)
+			once = 1;
+		else if(strcmp(argv[i], "-interval") == 0 && i+1 < argc)
+			interval = atoi(argv[++i]);
+		else{
+			printf("Error: illegal argument: %s\n", argv[i]);
+			return 1;
+		}
+	}
+	if(interval < 10)
+		interval = 10;
+
+	while(1){
+		if(!once)
+			printf("\033[H\033[2J"); // clear the terminal
+		if(show_pages(dir) < 0)
+			return 1;
+		if(once)
+			return 0;
+		fflush(stdout);
+		usleep(interval * 1000);
+	}
+}
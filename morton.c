@@ -0,0 +1,75 @@
+#include "morton.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+/* Spreads the low MORTON_BITS bits of value out to every other bit */
+unsigned int morton_spread(unsigned int value){
+	value &= (1u << MORTON_BITS) - 1;
+	value = (value | (value << 8)) & 0x00FF00FFu;
+	value = (value | (value << 4)) & 0x0F0F0F0Fu;
+	value = (value | (value << 2)) & 0x33333333u;
+	value = (value | (value << 1)) & 0x55555555u;
+	return value;
+}
+
+
+/* Key of a point: x in the even bits, y in the odd bits */
+unsigned int morton_key(int x, int y){
+	int limit = (1 << MORTON_BITS) - 1;
+	if(x < 0)
+		x = 0;
+	if(x > limit)
+		x = limit;
+	if(y < 0)
+		y = 0;
+	if(y > limit)
+		y = limit;
+	return morton_spread(x) | (morton_spread(y) << 1);
+}
+
+
+/* Sorts the point indices by key with a two pass radix sort (linear in
+ *	the number of points, and stable).
+ */
+void morton_order(int positions[], int count, int order[]){
+	int buckets = 1 << MORTON_RADIX_BITS;
+	unsigned int mask = buckets - 1;
+	unsigned int *keys = (unsigned int*)(malloc((count + 1) * sizeof(unsigned int)));
+	int *scratch = (int*)(malloc((count + 1) * sizeof(int)));
+	int *starts = (int*)(malloc((buckets + 1) * sizeof(int)));
+
+	int i;
+	for(i=0; i<count; i++){
+		keys[i] = morton_key(positions[2*i], positions[2*i+1]);
+		scratch[i] = i;
+	}
+
+	// low digit from scratch into order, then high digit back
+	int pass;
+	int *from = scratch;
+	int *to = order;
+	for(pass=0; pass<2; pass++){
+		int shift = pass * MORTON_RADIX_BITS;
+		memset(starts, 0, (buckets + 1) * sizeof(int));
+		for(i=0; i<count; i++){
+			starts[((keys[from[i]] >> shift) & mask) + 1]++;
+		}
+		for(i=0; i<buckets; i++){
+			starts[i+1] += starts[i];
+		}
+		for(i=0; i<count; i++){
+			to[starts[(keys[from[i]] >> shift) & mask]++] = from[i];
+		}
+		int *swap = from;
+		from = to;
+		to = swap;
+	}
+
+	// after two passes the result is back in scratch
+	memcpy(order, from, count * sizeof(int));
+	free(keys);
+	free(scratch);
+	free(starts);
+}
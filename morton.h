@@ -0,0 +1,28 @@
+#ifndef MORTON_H
+#define MORTON_H
+
+
+/* MORTON (Z-ORDER):
+ *	Interleaves the bits of x and y into one key, so that points close
+ *	together in the window mostly get keys close together. Sorting an
+ *	organism array by key puts organisms that are near each other in
+ *	the window near each other in memory, which keeps any spatial
+ *	lookup (grid cells, neighbour queries) in cache.
+ */
+
+// bits per coordinate (positions are clamped to 0 .. 2^MORTON_BITS-1)
+#define MORTON_BITS 10
+
+// radix sort digit size (two passes cover the 2*MORTON_BITS bit key)
+#define MORTON_RADIX_BITS MORTON_BITS
+
+
+/* Morton methods */
+unsigned int morton_key(int x, int y);
+
+// order gets the indices of the count points (x, y pairs) in Morton
+//	order (points with equal keys keep their order)
+void morton_order(int positions[], int count, int order[]);
+
+
+#endif
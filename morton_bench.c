@@ -0,0 +1,200 @@
+/* MORTON BENCHMARK:
+ *	Times the collision kernels on the default populations (100000
+ *	plants, 2000 herbivores) with the plants in random (creation)
+ *	order and in Morton order, and counts cache misses with the
+ *	hardware counters if the kernel allows it.
+ *		brute :: collide_brute, as run by the collision nodes
+ *		grid  :: every herbivore queries a neighbour grid of plants
+ *
+ *	$ make bench
+ *	$ ./morton_bench [plants] [herbivores] [repeats]
+ */
+
+#include "global.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <linux/perf_event.h>
+
+
+// cache miss counter (-1 if not available)
+int miss_counter = -1;
+
+
+/* Opens the hardware cache miss counter for this process */
+void open_miss_counter(){
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = PERF_COUNT_HW_CACHE_MISSES;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	miss_counter = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+
+void start_misses(){
+	if(miss_counter < 0)
+		return;
+	ioctl(miss_counter, PERF_EVENT_IOC_RESET, 0);
+	ioctl(miss_counter, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+long long stop_misses(){
+	long long misses = -1;
+	if(miss_counter < 0)
+		return misses;
+	ioctl(miss_counter, PERF_EVENT_IOC_DISABLE, 0);
+	if(read(miss_counter, &misses, sizeof(misses)) != sizeof(misses))
+		misses = -1;
+	return misses;
+}
+
+
+double now(){
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+
+/* GRID KERNEL: herbivores look up the plants within reach in a grid */
+void bench_collide_grid(NeighbourGrid *grid, int plants[], int num_plants,
+		int herbivores[], int num_herbivores, int radius,
+		char deaths[], int feeds[]){
+	int found[64];
+	int j, n;
+	build_neighbour_grid(grid, plants, num_plants);
+	for(j=0; j<num_herbivores; j++){
+		int num_found = query_radius(grid, herbivores[2*j], herbivores[2*j+1],
+			radius + 1, found, 64);
+		for(n=0; n<num_found; n++){
+			int i = found[n];
+			int dx = plants[2*i] - herbivores[2*j];
+			int dy = plants[2*i+1] - herbivores[2*j+1];
+			if(deaths[i] == 0 && dx <= radius && dx >= -radius &&
+					dy <= radius && dy >= -radius){
+				deaths[i] = 1;
+				feeds[j]++;
+			}
+		}
+	}
+}
+
+
+/* Runs one kernel repeats times, and prints time and misses per run */
+void run_kernel(char *name, char *order, int kernel,
+		int plants[], int num_plants, int herbivores[], int num_herbivores,
+		int repeats){
+	char *deaths = (char*)(malloc(num_plants + 1));
+	int *feeds = (int*)(malloc((num_herbivores + 1) * sizeof(int)));
+	NeighbourGrid grid;
+	init_neighbour_grid(&grid, 8, num_plants);
+
+	double best = 1e30;
+	long long misses = -1;
+	int eaten = 0;
+	int r, i;
+	for(r=0; r<repeats; r++){
+		memset(deaths, 0, num_plants);
+		memset(feeds, 0, num_herbivores * sizeof(int));
+		start_misses();
+		double start = now();
+		if(kernel == 0){
+			collide_brute(plants, num_plants, herbivores, num_herbivores,
+				PLANT_HERBIVORE_RADIUS, deaths, feeds);
+		}
+		else{
+			bench_collide_grid(&grid, plants, num_plants, herbivores, num_herbivores,
+				PLANT_HERBIVORE_RADIUS, deaths, feeds);
+		}
+		double time = now() - start;
+		long long run_misses = stop_misses();
+		if(time < best){
+			best = time;
+			misses = run_misses;
+		}
+	}
+	for(i=0; i<num_plants; i++){
+		eaten += deaths[i];
+	}
+
+	if(misses >= 0){
+		printf("%-6s %-8s %10.3f ms %14lld misses  (%d eaten)\n",
+			name, order, best * 1000, misses, eaten);
+	}
+	else{
+		printf("%-6s %-8s %10.3f ms %14s misses  (%d eaten)\n",
+			name, order, best * 1000, "n/a", eaten);
+	}
+	free_neighbour_grid(&grid);
+	free(deaths);
+	free(feeds);
+}
+
+
+/* The simulator's arguments (envsim.c is not linked in): the bench
+ *	takes its own, and never reads a scenario.
+ */
+int process_args(int argc, char **argv){
+	return 1;
+}
+
+
+int main(int argc, char **argv){
+	int num_plants = (argc > 1) ? atoi(argv[1]) : 100000;
+	int num_herbivores = (argc > 2) ? atoi(argv[2]) : 2000;
+	int repeats = (argc > 3) ? atoi(argv[3]) : 3;
+
+	// same distribution as the organism nodes (in a window-sized world)
+	world_width = WINDOW_WIDTH;
+	world_height = WINDOW_HEIGHT;
+	srand(1);
+	int *plants = (int*)(malloc(num_plants * 2 * sizeof(int)));
+	int *sorted = (int*)(malloc(num_plants * 2 * sizeof(int)));
+	int *herbivores = (int*)(malloc(num_herbivores * 2 * sizeof(int)));
+	int i;
+	for(i=0; i<num_plants; i++){
+		plants[2*i] = rand() % ORGANISM_X_MAX + ORGANISM_X_MIN;
+		plants[2*i+1] = rand() % ORGANISM_Y_MAX + ORGANISM_Y_MIN;
+	}
+	for(i=0; i<num_herbivores; i++){
+		herbivores[2*i] = rand() % ORGANISM_X_MAX + ORGANISM_X_MIN;
+		herbivores[2*i+1] = rand() % ORGANISM_Y_MAX + ORGANISM_Y_MIN;
+	}
+
+	// Morton-ordered copy of the plants
+	int *order = (int*)(malloc(num_plants * sizeof(int)));
+	double start = now();
+	morton_order(plants, num_plants, order);
+	for(i=0; i<num_plants; i++){
+		sorted[2*i] = plants[2*order[i]];
+		sorted[2*i+1] = plants[2*order[i]+1];
+	}
+	double sort_time = now() - start;
+
+	open_miss_counter();
+	printf("%d plants, %d herbivores, best of %d runs", num_plants,
+		num_herbivores, repeats);
+	printf(" (Morton sort took %.3f ms)\n", sort_time * 1000);
+	if(miss_counter < 0)
+		printf("(hardware cache miss counter not available)\n");
+	run_kernel("brute", "random", 0, plants, num_plants,
+		herbivores, num_herbivores, repeats);
+	run_kernel("brute", "morton", 0, sorted, num_plants,
+		herbivores, num_herbivores, repeats);
+	run_kernel("grid", "random", 1, plants, num_plants,
+		herbivores, num_herbivores, repeats);
+	run_kernel("grid", "morton", 1, sorted, num_plants,
+		herbivores, num_herbivores, repeats);
+
+	free(plants);
+	free(sorted);
+	free(herbivores);
+	free(order);
+	return 0;
+}
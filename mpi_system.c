@@ -1,5 +1,7 @@
 #include "mpi_system.h"
 
+#include <string.h>
+
 
 /* INIT MPI SYSTEM
  *	Initializes the MPI library, and returns the rank
@@ -7,21 +9,343 @@
  */
 void init_mpi(int argc, char **argv){
 	MPI_Init(&argc, &argv);
-	MPI_Comm_size(MPI_COMM_WORLD, &num_processors);
-	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	// every node gets the scenario's settings (if any)
+	init_scenario(argc, argv);
+
+	// every node gets the food web (before groups are sized)
+	init_foodweb();
+
+	// one simulation on all nodes, or one per ensemble group
+	sim_comm = MPI_COMM_WORLD;
+	ensemble_group = 0;
+	num_groups = 1;
+	if(ensemble_path != NULL){
+		init_ensemble();
+		if(sim_comm == MPI_COMM_NULL)
+			return; // left over, not in any group
+	}
+
+	MPI_Comm_size(sim_comm, &num_processors);
+	MPI_Comm_rank(sim_comm, &rank);
 	printf("Initialize MPI complete for node %d\n", rank);
 }
 
 
+/* Role of the given node, following the shard layout.
+ *	type and shard (if not NULL) get the organism type and shard of
+ *	organism nodes.
+ */
+int layout_node(int node, int *type, int *shard){
+	if(node == 0)
+		return ROLE_HEAD;
+	if(node >= first_collision_node &&
+			node < first_collision_node + num_collision_nodes)
+		return ROLE_COLLISION;
+	int t, s;
+	for(t=0; t<num_species; t++){
+		for(s=0; s<num_shards[t]; s++){
+			if(shard_nodes[t][s] == node){
+				if(type != NULL)
+					*type = t;
+				if(shard != NULL)
+					*shard = s;
+				return ROLE_ORGANISM;
+			}
+		}
+	}
+	return ROLE_UNUSED;
+}
+
+
+/* Places every interaction on a collision node: heaviest first (the
+ *	product of the two starting populations, the cost of checking every
+ *	pair), each onto the collision node with the least work so far.
+ *	The same on every node.
+ */
+void schedule_interactions(){
+	double load[MAX_INTERACTIONS];
+	int placed[MAX_INTERACTIONS];
+	int i, n;
+	for(n=0; n<num_collision_nodes; n++){
+		load[n] = 0;
+	}
+	for(i=0; i<num_interactions; i++){
+		placed[i] = 0;
+	}
+	for(n=0; n<num_interactions; n++){
+		// heaviest interaction not placed yet (first one on ties)
+		int heaviest = -1;
+		double weight = -1;
+		for(i=0; i<num_interactions; i++){
+			double w = (double)species[interactions[i].prey].count
+				* species[interactions[i].predator].count;
+			if(!placed[i] && w > weight){
+				heaviest = i;
+				weight = w;
+			}
+		}
+		// least loaded collision node (first one on ties)
+		int lightest = 0;
+		for(i=1; i<num_collision_nodes; i++){
+			if(load[i] < load[lightest])
+				lightest = i;
+		}
+		placed[heaviest] = 1;
+		load[lightest] += weight;
+		interactions[heaviest].node = first_collision_node + lightest;
+	}
+}
+
+
+/* INIT LAYOUT
+ *	Places the shards of every organism type and the interactions on
+ *	nodes (the same on every node), and creates the communicator each
+ *	type's shards use to rebalance. Extra shards that do not fit on
+ *	the available nodes are dropped. This node's role is taken from its
+ *	rank in the topology communicator (see init_topology).
+ */
+void init_layout(){
+	// collision nodes: one per interaction, as far as nodes go
+	first_collision_node = num_species + 1;
+	num_collision_nodes = num_processors - first_collision_node;
+	if(num_collision_nodes > num_interactions)
+		num_collision_nodes = num_interactions;
+	// FUSED: all interactions on one node (the rest go to shards)
+	if(fused_collisions && num_collision_nodes > 1)
+		num_collision_nodes = 1;
+	if(num_collision_nodes < 0 ||
+			(num_interactions > 0 && num_collision_nodes == 0)){
+		if(rank == 0){
+			printf("Error: a food web of %d species needs at least %d nodes.\n",
+				num_species, first_collision_node + (num_interactions > 0));
+		}
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+	schedule_interactions();
+	if(rank == 0 && (foodweb_path != NULL || num_collision_nodes < num_interactions)){
+		int i;
+		for(i=0; i<num_interactions; i++){
+			printf("Collision node %d: %s eat %s\n", interactions[i].node,
+				species[interactions[i].predator].name,
+				species[interactions[i].prey].name);
+		}
+	}
+
+	int next = first_collision_node + num_collision_nodes;
+	int t, s;
+	for(t=0; t<num_species; t++){
+		int wanted = requested_shards[t];
+		if(wanted < 1)
+			wanted = 1;
+		if(wanted > MAX_SHARDS)
+			wanted = MAX_SHARDS;
+		shard_nodes[t][0] = t + 1;
+		num_shards[t] = 1;
+		for(s=1; s<wanted && next<num_processors; s++){
+			shard_nodes[t][s] = next++;
+			num_shards[t]++;
+		}
+		if(rank == 0 && num_shards[t] < wanted){
+			printf("Warning: only %d of %d shards of %s fit ",
+				num_shards[t], wanted, species[t].name);
+			printf("on %d nodes.\n", num_processors);
+		}
+	}
+
+	// let MPI place the nodes (the shard layout is the same on every
+	//	node, so roles follow the new rank)
+	init_topology();
+
+	organism_type = 0;
+	shard_index = 0;
+	node_role = layout_node(rank, &organism_type, &shard_index);
+	MPI_Comm_split(sim_comm,
+		node_role == ROLE_ORGANISM ? organism_type : MPI_UNDEFINED,
+		shard_index, &shard_comm);
+	init_display_comm();
+}
+
+
+/* Number of organisms the given shard gets out of total (the first
+ *	total % shards shards get one extra).
+ */
+int shard_share(int total, int shard, int shards){
+	return total / shards + (shard < total % shards ? 1 : 0);
+}
+
+
+/* Bytes the node from is expected to send the node to each step,
+ *	following the shard layout and current options (at least 1 for
+ *	every link used, 0 if the two never talk).
+ */
+int link_bytes(int from, int to){
+	int from_type = 0, from_shard = 0;
+	int to_type = 0, to_shard = 0;
+	int from_role = layout_node(from, &from_type, &from_shard);
+	int to_role = layout_node(to, &to_type, &to_shard);
+	if(from == to || from_role == ROLE_UNUSED || to_role == ROLE_UNUSED)
+		return 0;
+
+	// head node: continue messages to every node
+	if(from_role == ROLE_HEAD)
+		return sizeof(int);
+
+	// organism nodes: report header, and position (or density) report
+	//	(collectives on display_comm, counted as if sent straight to
+	//	the head node)
+	int bytes = 0;
+	if(to_role == ROLE_HEAD){
+		if(from_role != ROLE_ORGANISM)
+			return 0;
+		int count = shard_share(num_organisms_of(from_type), from_shard,
+			num_shards[from_type]);
+		// (at most: only those inside the viewport are sent)
+		if(lod_cell_size > 0)
+			bytes = num_species * lod_cell_count() * sizeof(int);
+		else
+			bytes = count * 2 * sizeof(float);
+		return bytes + REPORT_HEADER * sizeof(int);
+	}
+
+	// organism shards to the collision nodes of their type (once per
+	//	collision node, however many of its interactions need them)
+	int i;
+	if(from_role == ROLE_ORGANISM && to_role == ROLE_COLLISION){
+		for(i=0; i<num_interactions; i++){
+			Interaction *interaction = &interactions[i];
+			if(interaction->node == to && (interaction->prey == from_type ||
+					interaction->predator == from_type)){
+				int count = shard_share(num_organisms_of(from_type),
+					from_shard, num_shards[from_type]);
+				bytes = count * collision_stride(from_type) * sizeof(int);
+				return bytes > 0 ? bytes : 1;
+			}
+		}
+		return 0;
+	}
+
+	// collision nodes: death reports to prey, feed reports to
+	//	predators (and ghosts of the other type, if perceiving), for
+	//	every interaction of the collision node
+	//	(FUSED: one combined report of both instead)
+	if(from_role == ROLE_COLLISION && to_role == ROLE_ORGANISM){
+		int linked = 0;
+		int count = shard_share(num_organisms_of(to_type), to_shard,
+			num_shards[to_type]);
+		if(fused_collisions)
+			bytes = count * (sizeof(char) + sizeof(int));
+		for(i=0; i<num_interactions; i++){
+			Interaction *interaction = &interactions[i];
+			if(interaction->node != from)
+				continue;
+			int other;
+			if(interaction->prey == to_type){
+				if(!fused_collisions)
+					bytes += count * sizeof(char);
+				other = interaction->predator;
+			}
+			else if(interaction->predator == to_type){
+				if(!fused_collisions)
+					bytes += count * sizeof(int);
+				other = interaction->prey;
+			}
+			else{
+				continue;
+			}
+			if(interaction_ghosts(i))
+				bytes += num_organisms_of(other) * 2 * sizeof(int);
+			linked = 1;
+		}
+		if(!linked)
+			return 0;
+		return bytes > 0 ? bytes : 1;
+	}
+
+	// shards only talk to each other when rebalancing, and collision
+	//	nodes never talk to each other
+	return 0;
+}
+
+
+/* INIT TOPOLOGY
+ *	Describes this node's links (both ways) to MPI as part of a
+ *	distributed graph and switches sim_comm over to the graph
+ *	communicator. With topology_reorder, rank may change (on every
+ *	node but the head, which stays node 0).
+ */
+void init_topology(){
+	int *sources = (int*)(malloc(num_processors * sizeof(int)));
+	int *source_weights = (int*)(malloc(num_processors * sizeof(int)));
+	int *destinations = (int*)(malloc(num_processors * sizeof(int)));
+	int *destination_weights = (int*)(malloc(num_processors * sizeof(int)));
+	int num_sources = 0;
+	int num_destinations = 0;
+	int node;
+	for(node=0; node<num_processors; node++){
+		int bytes = link_bytes(node, rank);
+		if(bytes > 0){
+			sources[num_sources] = node;
+			source_weights[num_sources++] = bytes;
+		}
+		bytes = link_bytes(rank, node);
+		if(bytes > 0){
+			destinations[num_destinations] = node;
+			destination_weights[num_destinations++] = bytes;
+		}
+	}
+
+	MPI_Comm graph_comm;
+	MPI_Dist_graph_create_adjacent(sim_comm,
+		num_sources, sources, source_weights,
+		num_destinations, destinations, destination_weights,
+		MPI_INFO_NULL, topology_reorder, &graph_comm);
+	free(sources);
+	free(source_weights);
+	free(destinations);
+	free(destination_weights);
+
+	// the head node stays node 0 (it holds the window, stdin and the
+	//	output files, and mpiexec starts it on the display host): it
+	//	swaps places with whichever node MPI put first, and every other
+	//	node keeps the place MPI gave it
+	int placed, head_placed;
+	MPI_Comm_rank(graph_comm, &placed);
+	head_placed = placed;
+	MPI_Bcast(&head_placed, 1, MPI_INT, 0, sim_comm);
+	if(head_placed != 0){
+		int key = placed;
+		if(rank == 0)
+			key = 0;
+		else if(placed == 0)
+			key = head_placed;
+		MPI_Comm placed_comm;
+		MPI_Comm_split(graph_comm, 0, key, &placed_comm);
+		MPI_Comm_free(&graph_comm);
+		graph_comm = placed_comm;
+	}
+
+	int old_rank = rank;
+	sim_comm = graph_comm;
+	MPI_Comm_rank(sim_comm, &rank);
+	if(rank != old_rank)
+		printf("Node %d placed as node %d by the topology\n", old_rank, rank);
+}
+
+
 /* FOR HEAD NODE:
- * send initial data to all nodes not including head,
+ * send initial data to all organism nodes (every shard of every type),
  *	giving information for all nodes to start working.
  */
 void MPISendStatus(int buffer[], int count){
-	// loop to all processors aside from 0 (head) and send
-	int i;
-	for(i = 1; i<=3; i++){
-		MPI_Send(buffer, count, MPI_INT, i, 1, MPI_COMM_WORLD);
+	// loop to all organism nodes and send
+	int t, s;
+	for(t=0; t<num_species; t++){
+		for(s=0; s<num_shards[t]; s++){
+			MPI_Send(buffer, count, MPI_INT, shard_nodes[t][s], 1,
+				sim_comm);
+			telemetry_sent(count * sizeof(int));
+		}
 	}
 }
 
@@ -30,147 +354,294 @@ void MPISendStatus(int buffer[], int count){
  * receive the status buffer sent by head node, and use the data to
  *	establish correct values associated with this specific organism.
  */
-void MPIRecvStatus(){
+int MPIRecvStatus(){
 	int init_buffer[NUMBER_OF_ORGANISMS];
 	MPI_Recv(init_buffer, NUMBER_OF_ORGANISMS, MPI_INT, 0, 1,
-		MPI_COMM_WORLD, &status);
+		sim_comm, &status);
 
-	// collect number of organisms from init type
-	num_organisms = init_buffer[organism_type];
+	// collect number of organisms from init type (this shard's share)
+	int total = init_buffer[organism_type];
+	num_organisms = shard_share(total, shard_index, num_shards[organism_type]);
+	return total;
+}
+
+
+/* FOR SHARDS:
+ * exchange values with all shards of the same organism type.
+ */
+void MPIAllgatherShards(int values[], int count, int all[]){
+	MPI_Allgather(values, count, MPI_INT, all, count, MPI_INT, shard_comm);
+	telemetry_sent(count * sizeof(int));
+}
+
+
+/* FOR SHARDS:
+ * move packed organisms between shards of the same organism type.
+ */
+void MPIMigrateOrganisms(
+				int send[], int send_counts[], int send_displs[],
+				int recv[], int recv_counts[], int recv_displs[]){
+	MPI_Alltoallv(send, send_counts, send_displs, MPI_INT,
+		recv, recv_counts, recv_displs, MPI_INT, shard_comm);
+	int s, sent = 0;
+	for(s=0; s<num_shards[organism_type]; s++){
+		sent += send_counts[s];
+	}
+	telemetry_sent(sent * sizeof(int));
+}
+
+
+// DISPLAY REPORTS: organism type of every rank in display_comm (the
+//	head node is rank 0), the counts and offsets of the last headers
+//	gathered (head node), and the report in flight (worker nodes)
+int display_types[1 + NUMBER_OF_ORGANISMS * MAX_SHARDS];
+int display_size;
+int *report_headers = NULL;
+int *report_counts = NULL;
+int *report_displs = NULL;
+int report_header[REPORT_HEADER];
+MPI_Request report_requests[2];
+int report_pending = 0;
+
+
+/* ALL NODES (from init_layout): create display_comm out of the head
+ *	node and the organism shards, in type then shard order.
+ */
+void init_display_comm(){
+	int key = 0;
+	if(node_role == ROLE_ORGANISM)
+		key = 1 + organism_type * MAX_SHARDS + shard_index;
+	int joins = (node_role == ROLE_HEAD || node_role == ROLE_ORGANISM);
+	MPI_Comm_split(sim_comm, joins ? 0 : MPI_UNDEFINED, key, &display_comm);
+
+	display_size = 1;
+	display_types[0] = -1;
+	int t, s;
+	for(t=0; t<num_species; t++){
+		for(s=0; s<num_shards[t]; s++){
+			display_types[display_size++] = t;
+		}
+	}
+	if(node_role == ROLE_HEAD){
+		report_headers = (int*)(malloc(display_size * REPORT_HEADER * sizeof(int)));
+		report_counts = (int*)(malloc(display_size * sizeof(int)));
+		report_displs = (int*)(malloc(display_size * sizeof(int)));
+	}
 }
 
 
 /* FOR WORKER NODES:
- * send positional reports to the head node, following:
+ * start this update's report header (organisms, births, eaten,
+ *	starved, organisms in the viewport). The values are copied, so
+ *	header may change right away.
+ */
+void MPISendReportHeader(int header[]){
+	MPIWaitReport();
+	memcpy(report_header, header, sizeof(report_header));
+	MPI_Igather(report_header, REPORT_HEADER, MPI_INT, NULL, 0, MPI_INT,
+		0, display_comm, &report_requests[0]);
+	report_pending = 1;
+	telemetry_sent(REPORT_HEADER * sizeof(int));
+}
+
+
+/* FOR WORKER NODES:
+ * start sending positional reports to the head node, following:
  *	count = twice the number of organisms associated with this node
  *	buffer[] containing x followed by y position for each organism.
+ *	(after MPISendReportHeader, with the same number of organisms)
  */
 void MPISendPosReport(float buffer[], int count){
-	MPI_Send(buffer, count, MPI_FLOAT, 0, 1, MPI_COMM_WORLD);
+	MPI_Igatherv(buffer, count, MPI_FLOAT, NULL, NULL, NULL, MPI_FLOAT,
+		0, display_comm, &report_requests[1]);
+	report_pending = 2;
+	telemetry_sent(count * sizeof(float));
+}
+
+
+/* FOR WORKER NODES (LOD MODE):
+ * start sending density grids to the head node: count ints, one grid
+ *	per organism type, all zero except this node's type. The grids of
+ *	all shards are summed on the way (a reduction tree), so the
+ *	payload size is fixed by the grid dimensions, no matter how many
+ *	organisms or shards there are.
+ */
+void MPISendDensityReport(int buffer[], int count){
+	MPI_Ireduce(buffer, NULL, count, MPI_INT, MPI_SUM, 0, display_comm,
+		&report_requests[1]);
+	report_pending = 2;
+	telemetry_sent(count * sizeof(int));
+}
+
+
+/* FOR WORKER NODES:
+ * finish the report in flight, if any (before its buffers change).
+ */
+void MPIWaitReport(){
+	if(report_pending > 0){
+		MPI_Waitall(report_pending, report_requests, MPI_STATUSES_IGNORE);
+		report_pending = 0;
+	}
 }
 
 
 /* FOR HEAD NODE:
- * receive positional reports from each worker node and return
- *	the buffer as needed to the display system to use.
- */
-void MPIRecvPosReport(
-				float *plants, int plant_count,
-				float *herbivores, int herbivore_count,
-				float *predators, int predator_count
-					){
-	
-	int cur_count = 0; // termporary count variable
-	
-	int i; // receive display data from each processor
-	for(i = 1; i<=3; i++){
-	
-		// receive locations from plants node
-		if(i == 1 && plant_loc_count > 0){
-			MPI_Recv(plants, num_plants*2,
-				MPI_FLOAT, i, 1, MPI_COMM_WORLD, &status);
-			// adjust number of plants
-			MPI_Get_count(&status,  MPI_FLOAT, &cur_count);
-			plant_loc_count = cur_count / 2;
-		}
-		
-		// receive locations from herbivores node
-		else if(i == 2 && herbivore_loc_count > 0){
-			MPI_Recv(herbivores, num_herbivores*2,
-				MPI_FLOAT, i, 1, MPI_COMM_WORLD, &status);
-			// adjust number of herbivores
-			MPI_Get_count(&status,  MPI_FLOAT, &cur_count);
-			herbivore_loc_count = cur_count / 2;
-		}
-		
-		// receive locations from predators node
-		else if(i == 3 && predator_loc_count > 0){
-			MPI_Recv(predators, num_predators*2,
-				MPI_FLOAT, i, 1, MPI_COMM_WORLD, &status);
-			// adjust number of predators
-			MPI_Get_count(&status,  MPI_FLOAT, &cur_count);
-			predator_loc_count = cur_count / 2;
+ * receive the report headers of every shard: sets organism_loc_count
+ *	and organism_view_count of every type, and adds up each type's
+ *	statistics (births, eaten, starved) into stats.
+ */
+void MPIRecvReportHeaders(int stats[][3]){
+	MPI_Igather(MPI_IN_PLACE, REPORT_HEADER, MPI_INT, report_headers,
+		REPORT_HEADER, MPI_INT, 0, display_comm, &request);
+	MPI_Wait(&request, &status);
+
+	int type, r, i;
+	memset(stats, 0, NUMBER_OF_ORGANISMS * sizeof(stats[0]));
+	for(type=0; type<num_species; type++){
+		organism_loc_count[type] = 0;
+		organism_view_count[type] = 0;
+	}
+	for(r=1; r<display_size; r++){
+		int *header = &report_headers[r * REPORT_HEADER];
+		type = display_types[r];
+		organism_loc_count[type] += header[0];
+		organism_view_count[type] += header[4];
+		for(i=0; i<3; i++){
+			stats[type][i] += header[1+i];
 		}
 	}
 }
 
 
+/* FOR HEAD NODE:
+ * receive positional reports from every worker node (in whatever
+ *	order they arrive) into one block, each type's shards next to each
+ *	other, and point locs[type] at each type's part.
+ *	(after MPIRecvReportHeaders, which tells how many each one sends)
+ */
+void MPIRecvPosReport(float block[], float *locs[]){
+	int offset = 0;
+	int r, type;
+	report_counts[0] = 0;
+	report_displs[0] = 0;
+	for(r=1; r<display_size; r++){
+		report_counts[r] = report_headers[r * REPORT_HEADER + 4] * 2;
+		report_displs[r] = offset;
+		offset += report_counts[r];
+	}
+	MPI_Igatherv(MPI_IN_PLACE, 0, MPI_FLOAT, block, report_counts,
+		report_displs, MPI_FLOAT, 0, display_comm, &request);
+	MPI_Wait(&request, &status);
+
+	offset = 0;
+	for(type=0; type<num_species; type++){
+		locs[type] = &block[offset];
+		offset += organism_view_count[type] * 2;
+	}
+}
+
+
+/* FOR HEAD NODE (LOD MODE):
+ * receive the density grids of every organism type (count ints each,
+ *	summed over all shards) into one block, and point grids[type] at
+ *	each type's grid.
+ */
+void MPIRecvDensityReport(int block[], int *grids[], int count){
+	memset(block, 0, num_species * count * sizeof(int));
+	MPI_Ireduce(MPI_IN_PLACE, block, num_species * count, MPI_INT, MPI_SUM,
+		0, display_comm, &request);
+	MPI_Wait(&request, &status);
+
+	int type;
+	for(type=0; type<num_species; type++){
+		grids[type] = &block[type * count];
+	}
+}
+
 
 
 // COLLISION NODES:
 // send collision data (the actual x and y locations)
-//	to get the COLL_PLANTS_HERBIVORES node to calculate collisions
-void MPISendCollisionPos_PLANTS_HERBIVORES(int buffer[], int count){
-	MPI_Send(buffer, count, MPI_INT, COLL_PLANTS_HERBIVORES, 1, MPI_COMM_WORLD);
-}
-
-// receive collision data (the actual x and y locations)
-//	to calculate PLANT-HERBIVORE collisions
-void MPIRecvCollisionPos_PLANTS_HERBIVORES(
-				int *plants, int plant_count,
-				int *herbivores, int herb_count){
-	
-	// get plant location list
-	MPI_Recv(plants, plant_count, MPI_INT, PLANTS+1, 1,
-		MPI_COMM_WORLD, &status);
+//	to get a collision node to calculate collisions
+void MPISendCollisionPos(int buffer[], int count, int destination){
+	MPI_Send(buffer, count, MPI_INT, destination, 1, sim_comm);
+	telemetry_sent(count * sizeof(int));
+}
+
+// receive collision data (the actual x and y locations, or swept
+//	boxes) from every
+//	shard of an organism type, in shard order
+int MPIRecvCollisionPos(int type, int buffer[], int max, int stride,
+				int shard_counts[]){
+	int received = 0;
 	int cur_count;
-	MPI_Get_count(&status,  MPI_INT, &cur_count);
-	num_plants = cur_count/2;
-	
-	// get herbivore location list
-	MPI_Recv(herbivores, herb_count, MPI_INT, HERBIVORES+1, 1,
-		MPI_COMM_WORLD, &status);
-	MPI_Get_count(&status,  MPI_INT, &cur_count);
-	num_herbivores = cur_count/2;
+	int s;
+	for(s=0; s<num_shards[type]; s++){
+		MPI_Recv(&buffer[received], max - received, MPI_INT,
+			shard_nodes[type][s], 1, sim_comm, &status);
+		MPI_Get_count(&status,  MPI_INT, &cur_count);
+		shard_counts[s] = cur_count/stride;
+		received += cur_count;
+	}
+	return received/stride;
 }
 
-// send collision data (the actual x and y locations)
-//	to get the COLL_HERBIVORES_PREDATORS node to calculate collisions
-void MPISendCollisionPos_HERBIVORES_PREDATORS(int buffer[], int count){
-	MPI_Send(buffer, count, MPI_INT, COLL_HERBIVORES_PREDATORS, 1, MPI_COMM_WORLD);
-}
-
-// receive collision data (the actual x and y locations)
-//	to calculate HERBIVORE-PREDATOR collisions
-void MPIRecvCollisionPos_HERBIVORES_PREDATORS(
-				int *herbivores, int herb_count,
-				int *predators, int pred_count){
-	
-	// get herbivore location list
-	MPI_Recv(herbivores, herb_count, MPI_INT, HERBIVORES+1, 1,
-		MPI_COMM_WORLD, &status);
+
+// PERCEPTION: send ghost positions (x, y of another organism type)
+void MPISendGhostPos(int buffer[], int count, int destination){
+	MPI_Send(buffer, count, MPI_INT, destination, 1, sim_comm);
+	telemetry_sent(count * sizeof(int));
+}
+
+// PERCEPTION: receive ghost positions (up to max values)
+//	returns the number of ghosts received.
+int MPIRecvGhostPos(int buffer[], int max, int source){
 	int cur_count;
+	MPI_Recv(buffer, max, MPI_INT, source, 1, sim_comm, &status);
 	MPI_Get_count(&status,  MPI_INT, &cur_count);
-	num_herbivores = cur_count/2;
-	
-	// get predator location list
-	MPI_Recv(predators, pred_count, MPI_INT, PREDATORS+1, 1,
-		MPI_COMM_WORLD, &status);
-	MPI_Get_count(&status,  MPI_INT, &cur_count);
-	num_predators = cur_count/2;
+	return cur_count/2;
 }
 
-
 // send death reports of each organims (dead or alive) 0 = dead, 1 = alive
 void MPISendDeathReports(char buffer[], int count, int destination){
-	MPI_Send(buffer, count, MPI_CHAR, destination, 1, MPI_COMM_WORLD);
+	MPI_Send(buffer, count, MPI_CHAR, destination, 1, sim_comm);
+	telemetry_sent(count * sizeof(char));
 }
 
 // receive death reports of each organims (dead or alive) 0 = dead, 1 = alive
 void MPIRecvDeathReports(char *buffer, int count, int source){
-	MPI_Recv(buffer, count, MPI_CHAR, source, 1, MPI_COMM_WORLD, &status);
+	MPI_Recv(buffer, count, MPI_CHAR, source, 1, sim_comm, &status);
 }
 
 // send feed reports of each organism
 //	value at each position indicates how many things they ate
 void MPISendFeedReports(int buffer[], int count, int destination){
-	MPI_Send(buffer, count, MPI_INT, destination, 1, MPI_COMM_WORLD);
+	MPI_Send(buffer, count, MPI_INT, destination, 1, sim_comm);
+	telemetry_sent(count * sizeof(int));
 }
 
 // receive feed reports of each organism
 //	value at each position indicates how many things they ate
 void MPIRecvFeedReports(int *buffer, int count, int source){
-	MPI_Recv(buffer, count, MPI_INT, source, 1, MPI_COMM_WORLD, &status);
+	MPI_Recv(buffer, count, MPI_INT, source, 1, sim_comm, &status);
+}
+
+
+// FUSED: send a combined report (count deaths, then count feeds)
+void MPISendCombinedReport(char buffer[], int count, int destination){
+	int bytes = count * (sizeof(char) + sizeof(int));
+	MPI_Send(buffer, bytes, MPI_BYTE, destination, 1, sim_comm);
+	telemetry_sent(bytes);
+}
+
+// FUSED: receive a combined report (room for capacity organisms);
+//	returns the number of organisms in it
+int MPIRecvCombinedReport(char buffer[], int capacity, int source){
+	int bytes;
+	MPI_Recv(buffer, capacity * (sizeof(char) + sizeof(int)), MPI_BYTE,
+		source, 1, sim_comm, &status);
+	MPI_Get_count(&status, MPI_BYTE, &bytes);
+	return bytes / (sizeof(char) + sizeof(int));
 }
 
 
@@ -181,15 +652,28 @@ void MPIRecvFeedReports(int *buffer, int count, int source){
 void MPISendContinue(int TorF){
 	int i;
 	for(i = 1; i<=(num_processors-1); i++){
-		MPI_Send(&TorF, 1, MPI_INT, i, 1, MPI_COMM_WORLD);
+		MPI_Send(&TorF, 1, MPI_INT, i, 1, sim_comm);
+		telemetry_sent(sizeof(int));
 	}
 }
 
+// HEAD NODE: send the new viewport (x, y, width, height) to every
+//	organism node
+void MPISendViewport(int viewport[]){
+	MPI_Bcast(viewport, 4, MPI_INT, 0, display_comm);
+	telemetry_sent(4 * sizeof(int));
+}
+
+// ORGANISM NODES: receive the new viewport
+void MPIRecvViewport(int viewport[]){
+	MPI_Bcast(viewport, 4, MPI_INT, 0, display_comm);
+}
+
 // ALL OTHER NODES: receive the continue/discontinue package
 //	returns: 1 to continue, 0 to stop.
 int MPIReceiveContinue(){
 	int TorF;
-	MPI_Recv(&TorF, 1, MPI_INT, 0, 1, MPI_COMM_WORLD, &status);
+	MPI_Recv(&TorF, 1, MPI_INT, 0, 1, sim_comm, &status);
 	return TorF;
 }
 
@@ -199,5 +683,10 @@ int MPIReceiveContinue(){
  *	Use this on all nodes to clean up before node's task is done.
  */
 void MPIDone(){
+	telemetry_finish(); // mark this node's stats page as done
+	report_counters(); // print this node's hardware counters, if on
+	analytics_finish(); // last analytics reduction, if any
+	checkpoint_finish(); // collective, if checkpointing
+	ensemble_finish(); // collective over all groups, if in ensemble mode
 	MPI_Finalize();
 }
@@ -14,6 +14,11 @@
 //	how many processors there are, and which rank current machine is...
 int rank, num_processors;
 
+// communicator of this simulation: MPI_COMM_WORLD, or this node's
+//	group in ensemble mode (see ensemble.h). rank and num_processors
+//	are within it.
+MPI_Comm sim_comm;
+
 // MPI Status variable (used for receive calls)
 MPI_Request request;
 MPI_Status status;
@@ -21,15 +26,108 @@ MPI_Status status;
 
 
 // MPI INIT: returns rank and size in given pointer variables
+//	(sim_comm is MPI_COMM_NULL on nodes left out of every group)
 void init_mpi(int argc, char **argv);
 
 
 
+/************** NODE LAYOUT *******************/
+/* Node 0 is the head node, and shard 0 of each organism type (species
+ *	of the food web) runs on node type + 1. The next nodes are the
+ *	COLLISION NODES: one per interaction if there are enough nodes,
+ *	else the interactions are scheduled onto the ones there are,
+ *	heaviest first (by the product of the two starting populations) to
+ *	the least loaded node. With the built-in food web that is nodes 4
+ *	(plants and herbivores) and 5 (herbivores and predators). With
+ *	fused_collisions (see collision.h) there is one collision node only.
+ *	Every organism type can be split into several SHARDS, each on its
+ *	own node: extra shards take the nodes after the collision nodes in
+ *	type order. Collision nodes and the head node talk to every shard
+ *	of a type, in shard order.
+ */
+
+// most shards per organism type
+#define MAX_SHARDS 16
+
+// node roles
+#define ROLE_HEAD 0
+#define ROLE_ORGANISM 1
+#define ROLE_COLLISION 2
+#define ROLE_UNUSED 3
+
+// shards asked for on the command line (0 = 1 shard)
+int requested_shards[NUMBER_OF_ORGANISMS];
+
+// shards of each organism type, and the nodes they run on
+int num_shards[NUMBER_OF_ORGANISMS];
+int shard_nodes[NUMBER_OF_ORGANISMS][MAX_SHARDS];
+
+// collision nodes: first_collision_node, and the num_collision_nodes
+//	after it (interactions[i].node tells which runs interaction i)
+int first_collision_node;
+int num_collision_nodes;
+
+// this node's role (and shard of organism_type, if an organism node)
+int node_role;
+int shard_index;
+
+// communicator of all shards of this node's organism type
+//	(MPI_COMM_NULL on other nodes)
+MPI_Comm shard_comm;
+
+// communicator of the head node (rank 0) and every organism shard, in
+//	type then shard order, for the display reports
+//	(MPI_COMM_NULL on collision and unused nodes)
+MPI_Comm display_comm;
+
+// ALL NODES: work out the shard layout and this node's role
+void init_layout();
+
+// role of any node (and its organism type and shard, if it has one)
+int layout_node(int node, int *type, int *shard);
+
+// ALL NODES: place interactions on the collision nodes
+void schedule_interactions();
+
+// number of organisms shard gets when total are split over shards
+int shard_share(int total, int shard, int shards);
+
+
+/* TOPOLOGY: the nodes talk in a fixed pattern (organism shards to
+ *	their collision nodes and back, everyone to and from the head), so
+ *	init_layout describes it to MPI as a distributed graph, with every
+ *	link weighted by the bytes expected over it each step. If
+ *	topology_reorder is set, MPI may renumber the nodes so the heaviest
+ *	links stay within a host; the graph communicator becomes sim_comm.
+ *	The head node always stays node 0, where it was started.
+ */
+int topology_reorder;
+
+// expected bytes sent from one node to another each step (0 = no link)
+int link_bytes(int from, int to);
+
+// ALL NODES: replace sim_comm with the graph communicator
+void init_topology();
+
+
+
 // HEAD NODE: sends a buffer of values to all nodes as initialized data
 void MPISendStatus(int buffer[], int count);
 
 // WORKER NODES: receive the status buffer sent by head node.
-void MPIRecvStatus();
+//	sets num_organisms to this shard's share, and returns the
+//	total (starting) number of organisms of this type.
+int MPIRecvStatus();
+
+// SHARDS: exchange count values with every shard of this organism
+//	type (all = count values per shard, in shard order)
+void MPIAllgatherShards(int values[], int count, int all[]);
+
+// SHARDS: move organisms between shards of this organism type
+//	(counts and displacements in ints, per shard)
+void MPIMigrateOrganisms(
+	int send[], int send_counts[], int send_displs[],
+	int recv[], int recv_counts[], int recv_displs[]);
 
 
 
@@ -43,42 +141,97 @@ void MPIRecvStatus();
  *	the simulation should continue.
  */
 
-// WORKER NODES: sends a position report to the head node
+/* Reports are collectives over display_comm, so the head node takes
+ *	them in whatever order they complete, and its receive time grows
+ *	with the log of the number of shards rather than the number:
+ *	first a header from every shard (REPORT_HEADER ints: organisms,
+ *	then births, eaten and starved since the last report, and the
+ *	organisms inside the viewport), gathered; then the positions of
+ *	those inside the viewport (gathered, with the counts from the
+ *	headers) or, in LOD mode, the density grids of the viewport (summed
+ *	per type by a reduction).
+ *	Workers only start their reports, and finish them (MPIWaitReport)
+ *	before they change the buffers sent.
+ */
+#define REPORT_HEADER 5
+
+// ALL NODES: create display_comm (called by init_layout)
+void init_display_comm();
+
+// WORKER NODES: start sending the report header to the head node
+//	(finishes the last report first)
+void MPISendReportHeader(int header[]);
+
+// WORKER NODES: start sending a position report to the head node
 void MPISendPosReport(float buffer[], int count);
 // OLD VERSION: void MPISendPosReport(int buffer[], int count);
 
-// HEAD NODE: receive position report
-void MPIRecvPosReport(
-	float *plants, int num_plants,
-	float *herbivores, int num_herbivores,
-	float *predators, int num_predators);
+// LOD MODE (WORKER NODES): start sending density grids to the head node
+//	(one per organism type, all zero but this node's: buffer[0] of each
+//	is the population, followed by one count per grid cell)
+void MPISendDensityReport(int buffer[], int count);
+
+// WORKER NODES: finish the report in flight (if any)
+void MPIWaitReport();
+
+// HEAD NODE: receive every shard's header: sets organism_loc_count and
+//	organism_view_count, and sums the statistics of every organism type
+//	into stats
+void MPIRecvReportHeaders(int stats[][3]);
+
+// HEAD NODE: receive position reports into block, with locs[type]
+//	pointing at each organism type's positions
+void MPIRecvPosReport(float block[], float *locs[]);
+
+// LOD MODE (HEAD NODE): receive the density grids (count ints each,
+//	summed over shards) into block, with grids[type] pointing at each
+void MPIRecvDensityReport(int block[], int *grids[], int count);
+
+// CONTINUE MESSAGE values: 0 to stop, otherwise CONTINUE_RUN plus
+//	any flags asking all nodes to do something extra this step.
+#define CONTINUE_RUN 1
+#define CONTINUE_CHECKPOINT 2 // write a checkpoint (see checkpoint.h)
+#define CONTINUE_VIEWPORT 4 // a new viewport follows (see display.h)
+#define CONTINUE_ANALYTICS 8 // add up analytics (see analytics.h)
+#define CONTINUE_SNAPSHOT 16 // report every organism next (see display.h)
 
 // HEAD NODE: send whether or not to continue: 1 for yes, 0 for no.
+//	(may include CONTINUE_* flags)
 void MPISendContinue(int TorF);
 
 // WORKER NODES: receive the continue/discontinue package
-//	returns: 1 to continue, 0 to stop.
+//	returns: 0 to stop, nonzero (CONTINUE_RUN and flags) to continue.
 int MPIReceiveContinue();
 
+// HEAD NODE: send the new viewport to every organism node, right after
+//	a continue message with CONTINUE_VIEWPORT (a broadcast over
+//	display_comm, so collision nodes never see it)
+void MPISendViewport(int viewport[]);
+
+// ORGANISM NODES: receive the new viewport
+void MPIRecvViewport(int viewport[]);
+
 
 /**********************************************/
 /************* COLLISION NODES ****************/
 /**********************************************/
 
 
-// send and receive collision data (the actual x and y locations)
-//	to calculate PLANT-HERBIVORE collisions
-void MPISendCollisionPos_PLANTS_HERBIVORES(int buffer[], int count);
-void MPIRecvCollisionPos_PLANTS_HERBIVORES(
-	int *plants, int num_plants,
-	int *herbivores, int num_herbivores);
+// send collision data (the actual x and y locations) to a collision node
+void MPISendCollisionPos(int buffer[], int count, int destination);
 
-// send and receive collision data (the actual x and y locations)
-//	to calculate HERBIVORE-PREDATOR collisions
-void MPISendCollisionPos_HERBIVORES_PREDATORS(int buffer[], int count);
-void MPIRecvCollisionPos_HERBIVORES_PREDATORS(
-	int *herbivores, int num_herbivores,
-	int *predators, int num_predators);
+// receive collision data from every shard of an organism type, one
+//	after the other into buffer (room for max values, stride values
+//	per organism)
+//	shard_counts gets the number of organisms from each shard;
+//	returns the total number of organisms.
+int MPIRecvCollisionPos(int type, int buffer[], int max, int stride,
+	int shard_counts[]);
+
+// PERCEPTION: send and receive the positions of one organism type
+//	(x, y) to the organism nodes of the type that perceives it
+void MPISendGhostPos(int buffer[], int count, int destination);
+int MPIRecvGhostPos(int buffer[], int max, int source);
 
 // send and receive death reports of each organims (dead or alive)
 //	0 = dead, 1 = alive
@@ -90,6 +243,12 @@ void MPIRecvDeathReports(char buffer[], int count, int source);
 void MPISendFeedReports(int buffer[], int count, int destination);
 void MPIRecvFeedReports(int buffer[], int count, int source);
 
+// FUSED: send and receive one combined report per shard (count death
+//	reports, then count feed reports, as bytes); the receive returns
+//	the number of organisms in it
+void MPISendCombinedReport(char buffer[], int count, int destination);
+int MPIRecvCombinedReport(char buffer[], int capacity, int source);
+
 /**********************************************/
 /**********************************************/
 /**********************************************/
@@ -0,0 +1,159 @@
+#include "global.h" // (includes neighbour.h)
+
+#include <string.h>
+
+
+/* Cell of a point (points outside the world go in the edge cells) */
+int neighbour_cell(NeighbourGrid *grid, int x, int y){
+	int column = x / grid->cell_size;
+	int row = y / grid->cell_size;
+	if(column < 0)
+		column = 0;
+	if(column >= grid->width)
+		column = grid->width - 1;
+	if(row < 0)
+		row = 0;
+	if(row >= grid->height)
+		row = grid->height - 1;
+	return row * grid->width + column;
+}
+
+
+/* Initialize NEIGHBOUR GRID: cells of cell_size pixels covering the
+ *	world, for up to capacity points (bigger cells in very large worlds,
+ *	to keep to NEIGHBOUR_MAX_CELLS).
+ */
+void init_neighbour_grid(NeighbourGrid *grid, int cell_size, int capacity){
+	while((long long)(world_width / cell_size + 1) *
+			(world_height / cell_size + 1) > NEIGHBOUR_MAX_CELLS){
+		cell_size *= 2;
+	}
+	grid->cell_size = cell_size;
+	grid->width = world_width / cell_size + 1;
+	grid->height = world_height / cell_size + 1;
+	int cells = grid->width * grid->height;
+	grid->cell_start = (int*)(calloc(cells + 1, sizeof(int)));
+	grid->cell_fill = (int*)(calloc(cells, sizeof(int)));
+	grid->cells = (int*)(malloc((capacity + 1) * sizeof(int)));
+	grid->indices = (int*)(malloc((capacity + 1) * sizeof(int)));
+	grid->points = NULL;
+	grid->count = 0;
+	grid->capacity = capacity;
+}
+
+void free_neighbour_grid(NeighbourGrid *grid){
+	free(grid->cell_start);
+	free(grid->cell_fill);
+	free(grid->cells);
+	free(grid->indices);
+}
+
+
+/* Sorts the given points into the grid (counting sort by cell) */
+void build_neighbour_grid(NeighbourGrid *grid, int points[], int count){
+	int cells = grid->width * grid->height;
+	if(count > grid->capacity)
+		count = grid->capacity;
+	grid->points = points;
+	grid->count = count;
+
+	// count the points in every cell
+	memset(grid->cell_start, 0, (cells + 1) * sizeof(int));
+	int i;
+	for(i=0; i<count; i++){
+		grid->cells[i] = neighbour_cell(grid, points[2*i], points[2*i+1]);
+		grid->cell_start[grid->cells[i] + 1]++;
+	}
+
+	// turn the counts into starting indices
+	for(i=0; i<cells; i++){
+		grid->cell_start[i+1] += grid->cell_start[i];
+	}
+
+	// place every point in its cell
+	memcpy(grid->cell_fill, grid->cell_start, cells * sizeof(int));
+	for(i=0; i<count; i++){
+		grid->indices[grid->cell_fill[grid->cells[i]]++] = i;
+	}
+}
+
+
+/* Range of cells (inclusive) within radius of (x, y) */
+void neighbour_range(NeighbourGrid *grid, int x, int y, int radius,
+		int *first_cell, int *last_cell){
+	*first_cell = neighbour_cell(grid, x - radius, y - radius);
+	*last_cell = neighbour_cell(grid, x + radius, y + radius);
+}
+
+
+/* RADIUS QUERY: every point within radius (euclidean) of (x, y) */
+int query_radius(NeighbourGrid *grid, int x, int y, int radius,
+		int found[], int max){
+	int first_cell, last_cell;
+	neighbour_range(grid, x, y, radius, &first_cell, &last_cell);
+	int first_column = first_cell % grid->width;
+	int last_column = last_cell % grid->width;
+	int radius2 = radius * radius;
+	int num_found = 0;
+
+	int row, i;
+	for(row = first_cell / grid->width; row <= last_cell / grid->width; row++){
+		// cells of one row are next to each other in the index list
+		int start = grid->cell_start[row * grid->width + first_column];
+		int end = grid->cell_start[row * grid->width + last_column + 1];
+		for(i=start; i<end; i++){
+			int index = grid->indices[i];
+			int dx = grid->points[2*index] - x;
+			int dy = grid->points[2*index+1] - y;
+			if(dx*dx + dy*dy <= radius2){
+				if(num_found == max)
+					return num_found;
+				found[num_found++] = index;
+			}
+		}
+	}
+	return num_found;
+}
+
+
+/* K-NEAREST QUERY: the k points nearest to (x, y), within radius.
+ *	Keeps a small sorted list of the best so far (k is small).
+ */
+int query_nearest(NeighbourGrid *grid, int x, int y, int radius,
+		int k, int found[]){
+	if(k > NEIGHBOUR_MAX_K)
+		k = NEIGHBOUR_MAX_K;
+	int first_cell, last_cell;
+	neighbour_range(grid, x, y, radius, &first_cell, &last_cell);
+	int first_column = first_cell % grid->width;
+	int last_column = last_cell % grid->width;
+	int best[NEIGHBOUR_MAX_K]; // squared distances of found
+	int num_found = 0;
+
+	int row, i;
+	for(row = first_cell / grid->width; row <= last_cell / grid->width; row++){
+		int start = grid->cell_start[row * grid->width + first_column];
+		int end = grid->cell_start[row * grid->width + last_column + 1];
+		for(i=start; i<end; i++){
+			int index = grid->indices[i];
+			int dx = grid->points[2*index] - x;
+			int dy = grid->points[2*index+1] - y;
+			int distance2 = dx*dx + dy*dy;
+			if(distance2 > radius * radius)
+				continue;
+			if(num_found == k && distance2 >= best[k-1])
+				continue;
+
+			// insert in order (dropping the farthest if full)
+			int place = (num_found < k) ? num_found++ : k - 1;
+			while(place > 0 && best[place-1] > distance2){
+				best[place] = best[place-1];
+				found[place] = found[place-1];
+				place--;
+			}
+			best[place] = distance2;
+			found[place] = index;
+		}
+	}
+	return num_found;
+}
@@ -0,0 +1,55 @@
+#ifndef NEIGHBOUR_H
+#define NEIGHBOUR_H
+
+
+/* NEIGHBOUR QUERIES:
+ *	A uniform grid over the world, holding the indices of a set of
+ *	points (x, y pairs) sorted by cell. Building it is one counting
+ *	sort (linear in the number of points), so it is simply rebuilt
+ *	whenever the points change. A query only visits the cells within
+ *	the query radius, so with cells as big as the radius each query
+ *	looks at 3x3 cells.
+ */
+
+// most neighbours a k-nearest query returns
+#define NEIGHBOUR_MAX_K 16
+
+// most cells in a grid
+#define NEIGHBOUR_MAX_CELLS (1 << 22)
+
+
+typedef struct {
+	int cell_size;
+	int width; // cells per row
+	int height; // rows of cells
+	int *cell_start; // first index of every cell (plus one past the end)
+	int *cell_fill; // (used while building)
+	int *cells; // cell of every point
+	int *indices; // point indices, sorted by cell
+	int *points; // the points (not copied)
+	int count;
+	int capacity;
+} NeighbourGrid;
+
+
+/* Neighbour grid methods */
+void init_neighbour_grid(NeighbourGrid *grid, int cell_size, int capacity);
+void free_neighbour_grid(NeighbourGrid *grid);
+void build_neighbour_grid(NeighbourGrid *grid, int points[], int count);
+
+// range of cells (first and last, inclusive) within radius of (x, y)
+void neighbour_range(NeighbourGrid *grid, int x, int y, int radius,
+	int *first_cell, int *last_cell);
+
+// indices of all points within radius of (x, y) (up to max of them);
+//	returns how many were found
+int query_radius(NeighbourGrid *grid, int x, int y, int radius,
+	int found[], int max);
+
+// indices of the k points nearest to (x, y) within radius, nearest
+//	first; returns how many were found (at most k)
+int query_nearest(NeighbourGrid *grid, int x, int y, int radius,
+	int k, int found[]);
+
+
+#endif
@@ -0,0 +1,760 @@
+#include "organism.h"
+
+#include <string.h>
+
+
+// values stored per organism when migrating between shards
+//	(x, y, x velocity, y velocity, total feeds)
+#define ORGANISM_FIELDS 5
+
+
+/* Random velocity component: 1 to speed, either direction */
+int random_velocity(int speed){
+	int velocity = (rand() % speed + 1);
+	int dir = (rand() % 2);
+	if(dir == 0)
+		velocity *= -1;
+	return velocity;
+}
+
+
+/* Initialize POPULATION: allocate arrays for capacity organisms, and
+ *	create count organisms at random positions with random velocities
+ *	(species with speed 0 do not move).
+ */
+void init_population(Population *pop, int type, int count,
+		int limit, int capacity){
+	pop->type = type;
+	pop->count = count;
+	pop->limit = limit;
+	pop->capacity = capacity;
+	pop->positions = (int*)(calloc(capacity * 2 + 2, sizeof(int)));
+	pop->posF = (float*)(calloc(capacity * 2 + 2, sizeof(float)));
+	pop->x_velocity = (int*)(calloc(capacity + 1, sizeof(int)));
+	pop->y_velocity = (int*)(calloc(capacity + 1, sizeof(int)));
+	pop->total_feeds = (int*)(calloc(capacity + 1, sizeof(int)));
+	pop->num_eaten = 0;
+	pop->num_starved = 0;
+	pop->num_reproductions = 0;
+	pop->num_births = 0;
+
+	// random works as follows:
+	//	rand() % x		: generates a pseudonumber from 0 to (x-1)
+	//	then add offsets
+	int i;
+	for(i=0; i<count; i++){
+		pop->positions[2*i] = (rand() % ORGANISM_X_MAX + ORGANISM_X_MIN);
+		pop->positions[2*i+1] = (rand() % ORGANISM_Y_MAX + ORGANISM_Y_MIN);
+		if(species[type].speed > 0){
+			pop->x_velocity[i] = random_velocity(species[type].speed);
+			pop->y_velocity[i] = random_velocity(species[type].speed);
+		}
+	}
+}
+
+void free_population(Population *pop){
+	free(pop->positions);
+	free(pop->posF);
+	free(pop->x_velocity);
+	free(pop->y_velocity);
+	free(pop->total_feeds);
+}
+
+
+/* Moves one organism one step, and reverses its velocity if it goes
+ *	out of bounds. Collision nodes use this too, to replay the path of
+ *	an organism when sub-stepping.
+ */
+void step_organism(int *x, int *y, int *x_velocity, int *y_velocity){
+	// update x-position
+	*x += *x_velocity;
+	// if x position is out of bounds, reverse velocity
+	if(*x < ORGANISM_X_MIN || *x > ORGANISM_X_MAX){
+		*x_velocity *= -1;
+		*x += *x_velocity;
+	}
+
+	// update y-position
+	*y += *y_velocity;
+	// if y position is out of bounds, reverse velocity
+	if(*y < ORGANISM_Y_MIN || *y > ORGANISM_Y_MAX){
+		*y_velocity *= -1;
+		*y += *y_velocity;
+	}
+}
+
+
+/* Update all positions, and check for possible reversal of velocity
+ *	(if out of bounds!)
+ */
+void move_population(Population *pop){
+	int *positions = pop->positions;
+	int i;
+	for(i=0; i<pop->count; i++){
+		step_organism(&positions[2*i], &positions[2*i+1],
+			&pop->x_velocity[i], &pop->y_velocity[i]);
+	}
+}
+
+
+/* Points a velocity along (dx, dy), keeping its speed (the larger of
+ *	its two components, since velocities are in whole pixels).
+ */
+void aim_velocity(int *x_velocity, int *y_velocity, int dx, int dy){
+	int speed = abs(*x_velocity) > abs(*y_velocity) ?
+		abs(*x_velocity) : abs(*y_velocity);
+	int length = abs(dx) > abs(dy) ? abs(dx) : abs(dy);
+	if(speed == 0 || length == 0)
+		return;
+	// round to the nearest pixel
+	*x_velocity = (dx * speed + (dx < 0 ? -length : length) / 2) / length;
+	*y_velocity = (dy * speed + (dy < 0 ? -length : length) / 2) / length;
+}
+
+
+/* PERCEPTION: steer every organism by the ghosts within
+ *	perception_radius. Organisms with threats (predators' ghosts) in
+ *	range head away from them (the sum of the directions away from
+ *	each); the others head for the nearest food (prey's ghost), if any.
+ *	Either grid may be NULL if this type has no such ghosts.
+ */
+void steer_population(Population *pop, NeighbourGrid *threats,
+		NeighbourGrid *food){
+	int found[PERCEPTION_MAX_NEIGHBOURS];
+	int i, n;
+	for(i=0; i<pop->count; i++){
+		int x = pop->positions[2*i];
+		int y = pop->positions[2*i+1];
+		int dx = 0;
+		int dy = 0;
+		int num_found = 0;
+		if(threats != NULL){
+			num_found = query_radius(threats, x, y, perception_radius,
+				found, PERCEPTION_MAX_NEIGHBOURS);
+			for(n=0; n<num_found; n++){
+				dx += x - threats->points[2*found[n]];
+				dy += y - threats->points[2*found[n]+1];
+			}
+		}
+		if(num_found == 0 && food != NULL){
+			if(query_nearest(food, x, y, perception_radius, 1, found) == 1){
+				dx = food->points[2*found[0]] - x;
+				dy = food->points[2*found[0]+1] - y;
+			}
+		}
+		aim_velocity(&pop->x_velocity[i], &pop->y_velocity[i], dx, dy);
+	}
+}
+
+
+/* Copies every organism's position and velocity (x, y, x velocity,
+ *	y velocity) into states: enough for a collision node to replay
+ *	the steps moved next (see step_organism).
+ */
+void population_states(Population *pop, int states[]){
+	int i;
+	for(i=0; i<pop->count; i++){
+		states[4*i] = pop->positions[2*i];
+		states[4*i+1] = pop->positions[2*i+1];
+		states[4*i+2] = pop->x_velocity[i];
+		states[4*i+3] = pop->y_velocity[i];
+	}
+}
+
+
+/* Removes organism i: move the last organism to this position and
+ *	decrease the number of organisms. Report entries (if given) move
+ *	along with it.
+ */
+void remove_organism(Population *pop, int i, int feeds[], char deaths[]){
+	int last = pop->count - 1;
+	pop->positions[2*i] = pop->positions[2*last];
+	pop->positions[2*i+1] = pop->positions[2*last+1];
+	pop->x_velocity[i] = pop->x_velocity[last];
+	pop->y_velocity[i] = pop->y_velocity[last];
+	pop->total_feeds[i] = pop->total_feeds[last];
+	if(feeds != NULL)
+		feeds[i] = feeds[last];
+	if(deaths != NULL)
+		deaths[i] = deaths[last];
+	pop->count--;
+}
+
+
+/* Adds a new organism at a random position at the end of the arrays */
+void add_organism(Population *pop){
+	int n = pop->count;
+	pop->positions[2*n] = (rand() % ORGANISM_X_MAX + ORGANISM_X_MIN);
+	pop->positions[2*n+1] = (rand() % ORGANISM_Y_MAX + ORGANISM_Y_MIN);
+	pop->total_feeds[n] = 0;
+	int speed = species[pop->type].speed;
+	if(speed == 0){
+		pop->x_velocity[n] = 0;
+		pop->y_velocity[n] = 0;
+	}
+	else{
+		pop->x_velocity[n] = random_velocity(speed);
+		pop->y_velocity[n] = random_velocity(speed);
+	}
+	pop->count++;
+}
+
+
+/* Removes the organisms marked in deaths (eaten) */
+void remove_eaten(Population *pop, int feeds[], char deaths[]){
+	int i;
+	for(i=0; i<pop->count; i++){
+		if(deaths[i] == (char)1){
+			remove_organism(pop, i, feeds, deaths);
+			i--;
+			pop->num_eaten++;
+		}
+	}
+}
+
+
+/* Applies one exchange's reports (over the given steps) to a population,
+ *	by the rules of its species (see foodweb.h):
+ *	species that eat apply their feeds (organisms starve if they haven't
+ *	fed enough, and reproduce if they have), then remove the eaten ones;
+ *	species that eat nothing remove the eaten ones, then regrow 1 new
+ *	organism for every regrow alive each step (if under the limit and
+ *	not extinct).
+ */
+void update_population(Population *pop, int feeds[], char deaths[], int steps){
+	Species *kind = &species[pop->type];
+	int i, step;
+	if(!kind->eats){
+		remove_eaten(pop, feeds, deaths);
+		for(step=0; kind->regrow > 0 && step<steps; step++){
+			if(pop->count < pop->limit && pop->count != 0){
+				int alive = pop->count;
+				int added = 0;
+				for(i=0; pop->count < pop->limit && i < alive; i+=kind->regrow){
+					add_organism(pop);
+					added++;
+				}
+				pop->num_reproductions++;
+				pop->num_births += added;
+			}
+		}
+		return;
+	}
+
+	i = 0;
+	while(i < pop->count){
+		pop->total_feeds[i] -= steps;
+		pop->total_feeds[i] += kind->feed_gain * feeds[i];
+		// organism starves if it hasn't fed
+		if(pop->total_feeds[i] < kind->starve_at){
+			remove_organism(pop, i, feeds, deaths);
+			pop->num_starved++;
+			continue;
+		}
+		// organism reproduces (once per step it is fed enough): create a
+		//	new organism at a random position
+		for(step=0; step<steps && pop->total_feeds[i] >= REPRODUCE_FEEDS &&
+				pop->count < pop->limit; step++){
+			feeds[pop->count] = 0;
+			deaths[pop->count] = 0;
+			add_organism(pop);
+			pop->num_reproductions++;
+			pop->num_births++;
+		}
+		i++;
+	}
+	remove_eaten(pop, feeds, deaths);
+}
+
+
+/* Overlap of the ranges [start1, start1+count1) and [start2, start2+count2)
+ *	returns the number of shared values, and their start in first.
+ */
+int range_overlap(int start1, int count1, int start2, int count2, int *first){
+	int low = start1 > start2 ? start1 : start2;
+	int high = (start1 + count1) < (start2 + count2) ?
+		(start1 + count1) : (start2 + count2);
+	*first = low;
+	return high > low ? high - low : 0;
+}
+
+
+/* SHARD REBALANCING: every shard of this organism type calls this at the
+ *	same step with its cost (seconds spent moving and updating since the
+ *	last call). If the slowest shard is more than REBALANCE_THRESHOLD
+ *	times the average, organisms are migrated so that each shard's share
+ *	is proportional to its measured speed.
+ *	Shards are treated as one array in shard order: every shard sends the
+ *	parts of its range that fall into other shards' new ranges, so only
+ *	organisms at the edges of each range move. Limits move the same way.
+ *	Called between applying reports and sending positions to the
+ *	collision nodes, so no report refers to the old order.
+ */
+void rebalance_population(Population *pop, double cost){
+	int shards = num_shards[pop->type];
+	int mine[3] = { pop->count, pop->limit, (int)(cost * 1000000) };
+	int all[3 * MAX_SHARDS];
+	MPIAllgatherShards(mine, 3, all);
+
+	int total = 0;
+	int total_limit = 0;
+	double total_cost = 0;
+	double max_cost = 0;
+	int s;
+	for(s=0; s<shards; s++){
+		total += all[3*s];
+		total_limit += all[3*s+1];
+		total_cost += all[3*s+2];
+		if(all[3*s+2] > max_cost)
+			max_cost = all[3*s+2];
+	}
+	if(total == 0 || total_cost <= 0 ||
+			max_cost < REBALANCE_THRESHOLD * total_cost / shards){
+		return;
+	}
+
+	// speed of each shard (organisms per microsecond); shards with
+	//	nothing to measure get the average speed
+	double speed[MAX_SHARDS];
+	double total_speed = 0;
+	for(s=0; s<shards; s++){
+		if(all[3*s] > 0 && all[3*s+2] > 0)
+			speed[s] = (double)all[3*s] / all[3*s+2];
+		else
+			speed[s] = total / total_cost;
+		total_speed += speed[s];
+	}
+
+	// current and new ranges of every shard
+	int start[MAX_SHARDS + 1];
+	int target[MAX_SHARDS + 1];
+	start[0] = 0;
+	target[0] = 0;
+	double prefix_speed = 0;
+	int moved = 0;
+	for(s=0; s<shards; s++){
+		start[s+1] = start[s] + all[3*s];
+		prefix_speed += speed[s];
+		target[s+1] = (int)(total * prefix_speed / total_speed + 0.5);
+		int change = (target[s+1] - target[s]) - all[3*s];
+		moved += change > 0 ? change : 0;
+	}
+	target[shards] = total;
+
+	// not worth moving less than 1% of the organisms
+	if(moved * 100 < total)
+		return;
+
+	// what this shard sends to and receives from every other shard
+	int me = shard_index;
+	int send_counts[MAX_SHARDS], send_displs[MAX_SHARDS];
+	int recv_counts[MAX_SHARDS], recv_displs[MAX_SHARDS];
+	for(s=0; s<shards; s++){
+		int first;
+		send_counts[s] = range_overlap(start[me], all[3*me],
+			target[s], target[s+1] - target[s], &first) * ORGANISM_FIELDS;
+		send_displs[s] = (first - start[me]) * ORGANISM_FIELDS;
+		recv_counts[s] = range_overlap(start[s], all[3*s],
+			target[me], target[me+1] - target[me], &first) * ORGANISM_FIELDS;
+		recv_displs[s] = (first - target[me]) * ORGANISM_FIELDS;
+	}
+
+	int new_count = target[me+1] - target[me];
+	int *outgoing = (int*)(malloc((pop->count + 1) * ORGANISM_FIELDS * sizeof(int)));
+	int *incoming = (int*)(malloc((new_count + 1) * ORGANISM_FIELDS * sizeof(int)));
+	int i;
+	for(i=0; i<pop->count; i++){
+		int *organism = &outgoing[i * ORGANISM_FIELDS];
+		organism[0] = pop->positions[2*i];
+		organism[1] = pop->positions[2*i+1];
+		organism[2] = pop->x_velocity[i];
+		organism[3] = pop->y_velocity[i];
+		organism[4] = pop->total_feeds[i];
+	}
+	MPIMigrateOrganisms(outgoing, send_counts, send_displs,
+		incoming, recv_counts, recv_displs);
+	for(i=0; i<new_count; i++){
+		int *organism = &incoming[i * ORGANISM_FIELDS];
+		pop->positions[2*i] = organism[0];
+		pop->positions[2*i+1] = organism[1];
+		pop->x_velocity[i] = organism[2];
+		pop->y_velocity[i] = organism[3];
+		pop->total_feeds[i] = organism[4];
+	}
+	free(outgoing);
+	free(incoming);
+
+	// limits follow the organisms (sum stays the same, and every shard
+	//	can hold what it was given)
+	pop->count = new_count;
+	pop->limit = (int)((long)total_limit * target[me+1] / total)
+		- (int)((long)total_limit * target[me] / total);
+	if(pop->limit < pop->count)
+		pop->limit = pop->count;
+
+	if(me == 0){
+		printf("(%d) Rebalanced organism type %d: moved %d of %d.\n",
+			rank, pop->type, moved, total);
+	}
+}
+
+
+/* LOCALITY: reorders all of the population's arrays into Morton order
+ *	of the positions. Called between applying reports and sending
+ *	positions, so no report refers to the old order and nothing has to
+ *	be remapped.
+ */
+void morton_sort_population(Population *pop){
+	int count = pop->count;
+	int *order = (int*)(malloc((count + 1) * sizeof(int)));
+	int *values = (int*)(malloc((count + 1) * 2 * sizeof(int)));
+	morton_order(pop->positions, count, order);
+
+	int i;
+	for(i=0; i<count; i++){
+		values[2*i] = pop->positions[2*order[i]];
+		values[2*i+1] = pop->positions[2*order[i]+1];
+	}
+	memcpy(pop->positions, values, count * 2 * sizeof(int));
+
+	int *arrays[3] = { pop->x_velocity, pop->y_velocity, pop->total_feeds };
+	int a;
+	for(a=0; a<3; a++){
+		for(i=0; i<count; i++){
+			values[i] = arrays[a][order[i]];
+		}
+		memcpy(arrays[a], values, count * sizeof(int));
+	}
+	free(order);
+	free(values);
+}
+
+
+/* CHECKPOINT: counters, then arrays for the whole capacity (the slot
+ *	size only depends on the starting populations).
+ */
+char *pack_population(char *cursor, Population *pop){
+	int counters[6] = {
+		pop->count, pop->limit, pop->num_eaten,
+		pop->num_starved, pop->num_reproductions, pop->num_births };
+	cursor = pack_ints(cursor, counters, 6);
+	cursor = pack_ints(cursor, pop->positions, 2*pop->capacity);
+	cursor = pack_ints(cursor, pop->x_velocity, pop->capacity);
+	cursor = pack_ints(cursor, pop->y_velocity, pop->capacity);
+	cursor = pack_ints(cursor, pop->total_feeds, pop->capacity);
+	return cursor;
+}
+
+char *unpack_population(char *cursor, Population *pop){
+	int counters[6];
+	cursor = unpack_ints(cursor, counters, 6);
+	cursor = unpack_ints(cursor, pop->positions, 2*pop->capacity);
+	cursor = unpack_ints(cursor, pop->x_velocity, pop->capacity);
+	cursor = unpack_ints(cursor, pop->y_velocity, pop->capacity);
+	cursor = unpack_ints(cursor, pop->total_feeds, pop->capacity);
+	pop->count = counters[0];
+	pop->limit = counters[1];
+	pop->num_eaten = counters[2];
+	pop->num_starved = counters[3];
+	pop->num_reproductions = counters[4];
+	pop->num_births = counters[5];
+	return cursor;
+}
+
+
+/* ORGANISM NODE: run one shard of organism_type until the head node
+ *	stops the simulation.
+ */
+void run_organism_node(){
+	// collect status from head node
+	//	this will tell how many organisms this node will have
+	//	have to deal with (its share of the organism type).
+	int capacity = MPIRecvStatus();
+
+	// create random x and y positions, and random x and y
+	//	velocities for each organism (seeded per node, so shards of
+	//	the same type do not start out identical)
+	unsigned int seed = sim_seed ? (unsigned int)sim_seed : (unsigned int)time(NULL);
+	srand(seed + rank);
+	Population pop;
+	init_population(&pop, organism_type, num_organisms, num_organisms, capacity);
+
+	// death and feed report buffers (reports of every interaction after
+	//	the first are received into the second pair and merged)
+	char *deaths = (char*)(calloc(capacity + 1, sizeof(char)));
+	int *feeds = (int*)(calloc(capacity + 1, sizeof(int)));
+	char *more_deaths = (char*)(calloc(capacity + 1, sizeof(char)));
+	int *more_feeds = (int*)(calloc(capacity + 1, sizeof(int)));
+
+	// FUSED: the combined report, and the collision node it comes from
+	//	(-1 if this type takes part in no interaction)
+	char *combined = NULL;
+	int fused_node = -1;
+	int i;
+	for(i=0; fused_collisions && i<num_interactions; i++){
+		if(interactions[i].prey == organism_type ||
+				interactions[i].predator == organism_type)
+			fused_node = interactions[i].node;
+	}
+	if(fused_node >= 0){
+		combined = (char*)(malloc(
+			(capacity + 1) * (sizeof(char) + sizeof(int))));
+	}
+
+	// PERCEPTION: ghosts of the types this one flees from (threats) and
+	//	chases (food), from every interaction that sends them, and the
+	//	grids to find them in
+	int threat_capacity = 0;
+	int food_capacity = 0;
+	for(i=0; i<num_interactions; i++){
+		if(!interaction_ghosts(i))
+			continue;
+		if(interactions[i].prey == organism_type)
+			threat_capacity += num_organisms_of(interactions[i].predator);
+		else if(interactions[i].predator == organism_type)
+			food_capacity += num_organisms_of(interactions[i].prey);
+	}
+	int *threats = NULL;
+	int *food = NULL;
+	NeighbourGrid threat_grid, food_grid;
+	if(threat_capacity > 0){
+		threats = (int*)(malloc((threat_capacity + 1) * 2 * sizeof(int)));
+		init_neighbour_grid(&threat_grid, perception_radius, threat_capacity);
+	}
+	if(food_capacity > 0){
+		food = (int*)(malloc((food_capacity + 1) * 2 * sizeof(int)));
+		init_neighbour_grid(&food_grid, perception_radius, food_capacity);
+	}
+	int perceiving = (threats != NULL || food != NULL);
+
+	// starting states sent to the collision nodes (sub-stepping only)
+	int *states = NULL;
+	if(collision_stride(organism_type) == 4)
+		states = (int*)(malloc((capacity + 1) * 4 * sizeof(int)));
+
+	// density report buffer (LOD mode only): a grid per organism type,
+	//	of which only this type's is ever filled in
+	int *density = NULL;
+	if(lod_cell_size > 0){
+		density = (int*)(calloc(num_species * lod_cell_count(), sizeof(int)));
+	}
+
+	// restore organisms and statistics from the restart file
+	if(restart_slot != NULL)
+		unpack_population(restart_slot, &pop);
+
+	// statistics already reported (births, eaten, starved)
+	int stats_sent[3] = { pop.num_births, pop.num_eaten, pop.num_starved };
+
+	// time spent on this node's own work since the last rebalance
+	int step = 0;
+	double cost = 0;
+	int k;
+
+	// loop until the head node stops the simulation
+	//	(each round: apply the reports on the last positions sent, move
+	//	substeps steps, and send the new positions)
+	while(1){
+		// receive reports from the collision nodes (in interaction
+		//	order): an organism is dead if any predator ate it, and its
+		//	feeds add up over every prey type
+		//	(FUSED: all in one combined report)
+		int got_deaths = 0;
+		int got_feeds = 0;
+		if(fused_node >= 0){
+			int count = MPIRecvCombinedReport(combined, capacity, fused_node);
+			memcpy(deaths, combined, count * sizeof(char));
+			memcpy(feeds, &combined[count], count * sizeof(int));
+		}
+		for(i=0; fused_node < 0 && i<num_interactions; i++){
+			if(interactions[i].prey == pop.type){
+				if(!got_deaths){
+					MPIRecvDeathReports(deaths, capacity, interactions[i].node);
+					got_deaths = 1;
+					continue;
+				}
+				MPIRecvDeathReports(more_deaths, capacity, interactions[i].node);
+				for(k=0; k<pop.count; k++){
+					deaths[k] |= more_deaths[k];
+				}
+			}
+			else if(interactions[i].predator == pop.type){
+				if(!got_feeds){
+					MPIRecvFeedReports(feeds, capacity, interactions[i].node);
+					got_feeds = 1;
+					continue;
+				}
+				MPIRecvFeedReports(more_feeds, capacity, interactions[i].node);
+				for(k=0; k<pop.count; k++){
+					feeds[k] += more_feeds[k];
+				}
+			}
+		}
+		telemetry_phase(PHASE_RECEIVE);
+
+		// and apply them
+		double start_time = MPI_Wtime();
+		update_population(&pop, feeds, deaths, substeps);
+		cost += MPI_Wtime() - start_time;
+		telemetry_phase(PHASE_UPDATE);
+
+		// receive the ghosts after the reports
+		int num_threats = 0;
+		int num_food = 0;
+		for(i=0; perceiving && i<num_interactions; i++){
+			if(!interaction_ghosts(i))
+				continue;
+			if(interactions[i].prey == pop.type){
+				num_threats += MPIRecvGhostPos(&threats[2*num_threats],
+					(threat_capacity - num_threats) * 2, interactions[i].node);
+			}
+			else if(interactions[i].predator == pop.type){
+				num_food += MPIRecvGhostPos(&food[2*num_food],
+					(food_capacity - num_food) * 2, interactions[i].node);
+			}
+		}
+		if(perceiving)
+			telemetry_phase(PHASE_RECEIVE);
+
+		// even out the work between shards of this organism type
+		step += substeps;
+		if(rebalance_interval > 0 && num_shards[pop.type] > 1 &&
+				step / rebalance_interval !=
+				(step - substeps) / rebalance_interval){
+			rebalance_population(&pop, cost);
+			cost = 0;
+		}
+		// keep organisms that are close in the window close in memory
+		if(morton_interval > 0 &&
+				step / morton_interval != (step - substeps) / morton_interval){
+			morton_sort_population(&pop);
+		}
+		num_organisms = pop.count;
+		telemetry_phase(PHASE_UPDATE);
+
+		// move (when sub-stepping, the collision nodes get the states
+		//	the organisms start moving from, and replay the steps)
+		start_time = MPI_Wtime();
+		if(perceiving){
+			if(threats != NULL)
+				build_neighbour_grid(&threat_grid, threats, num_threats);
+			if(food != NULL)
+				build_neighbour_grid(&food_grid, food, num_food);
+			steer_population(&pop, threats ? &threat_grid : NULL,
+				food ? &food_grid : NULL);
+		}
+		int *collision_data = pop.positions;
+		int collision_values = collision_stride(pop.type);
+		if(collision_values == 4){
+			population_states(&pop, states);
+			collision_data = states;
+		}
+		for(k=0; k<substeps; k++){
+			move_population(&pop);
+		}
+		cost += MPI_Wtime() - start_time;
+		telemetry_phase(PHASE_MOVE);
+
+		// send positions (or starting states) once to every collision
+		//	node that needs them
+		int node;
+		for(node=first_collision_node;
+				node<first_collision_node+num_collision_nodes; node++){
+			if(node_uses_species(node, pop.type)){
+				MPISendCollisionPos(collision_data, pop.count*collision_values,
+					node);
+			}
+		}
+
+		// report to the head node: organisms and this step's statistics,
+		//	then a fixed-size density grid in LOD mode, or the positions
+		//	of the organisms inside the viewport (the last report is
+		//	finished first, so its buffers can be refilled)
+		MPIWaitReport();
+		int visible = 0;
+		if(lod_cell_size > 0){
+			rasterize_density(pop.positions, pop.count,
+				&density[pop.type * lod_cell_count()]);
+		}
+		else{
+			// positions in the OpenGL float format (relative (-1, 1)
+			//	scale of the viewport) to display in the head node
+			visible = view_positions(pop.positions, pop.count, pop.posF);
+		}
+		int header[REPORT_HEADER] = {
+			pop.count,
+			pop.num_births - stats_sent[0],
+			pop.num_eaten - stats_sent[1],
+			pop.num_starved - stats_sent[2],
+			visible };
+		stats_sent[0] = pop.num_births;
+		stats_sent[1] = pop.num_eaten;
+		stats_sent[2] = pop.num_starved;
+		MPISendReportHeader(header);
+
+		if(lod_cell_size > 0)
+			MPISendDensityReport(density, num_species * lod_cell_count());
+		else
+			MPISendPosReport(pop.posF, visible*2);
+
+		telemetry_phase(PHASE_SEND);
+
+		// receive acknowledgement / report
+		int message = MPIReceiveContinue();
+		telemetry_phase(PHASE_RECEIVE);
+		telemetry_publish(step, pop.count, pop.num_births,
+			pop.num_eaten + pop.num_starved);
+		if(!message){
+			// if ack is not received (Head node called for stop
+			//	of operation), break the loop
+			break;
+		}
+
+		// report from the new viewport from now on
+		if(message & CONTINUE_VIEWPORT)
+			MPIRecvViewport(view);
+
+		// report every organism next time (a recorded snapshot)
+		world_report = (message & CONTINUE_SNAPSHOT) != 0;
+
+		// density of this node's organisms
+		if(message & CONTINUE_ANALYTICS){
+			analytics_begin();
+			analytics_species(organism_type, pop.positions, pop.count);
+			analytics_reduce(step);
+		}
+
+		// checkpoint this node's organisms and statistics
+		if(message & CONTINUE_CHECKPOINT){
+			pack_population(checkpoint_stage(), &pop);
+			checkpoint_write();
+		}
+		checkpoint_progress();
+		telemetry_phase(PHASE_SEND);
+	}
+
+	// once loop is broken (head node stopped the simulation), finish node
+	printf("Organism location node (%d) is done.\n", rank);
+	printf("(%d) ### STATISTICS:\n", rank);
+	printf("(%d) #### Got eaten: %d\n", rank, pop.num_eaten);
+	printf("(%d) #### Starved to death: %d\n", rank, pop.num_starved);
+	printf("(%d) #### Times reproduced: %d\n", rank, pop.num_reproductions);
+	free(deaths);
+	free(feeds);
+	free(more_deaths);
+	free(more_feeds);
+	free(combined);
+	free(states);
+	if(threats != NULL){
+		free(threats);
+		free_neighbour_grid(&threat_grid);
+	}
+	if(food != NULL){
+		free(food);
+		free_neighbour_grid(&food_grid);
+	}
+	MPIWaitReport();
+	free(density);
+	free_population(&pop);
+	MPIDone();
+}
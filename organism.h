@@ -0,0 +1,103 @@
+#ifndef ORGANISM_H
+#define ORGANISM_H
+
+
+/* Contains functions for global operations */
+#include "global.h"
+
+
+/* ORGANISM NODES:
+ *	Each organism node moves one shard of one organism type (a species
+ *	of the food web, see foodweb.h), applies the death and feed reports
+ *	it gets from the collision nodes of that species' interactions, and
+ *	reports positions to the head node every step.
+ */
+
+// velocities of the built-in web's moving organisms are in
+//	[-ORGANISM_MAX_SPEED, ORGANISM_MAX_SPEED] (other species: their speed)
+#define ORGANISM_MAX_SPEED 10
+
+// area organisms move in (pixels, inside the world)
+#define ORGANISM_X_MIN 15
+#define ORGANISM_Y_MIN 15
+#define ORGANISM_X_MAX (world_width - 30)
+#define ORGANISM_Y_MAX (world_height - 30)
+
+// most threats an organism flees from at once
+#define PERCEPTION_MAX_NEIGHBOURS 32
+
+// rebalance shards if the slowest shard's cost is this many times
+//	the average
+#define REBALANCE_THRESHOLD 1.25
+
+
+/* POPULATION: the organisms of one shard. Every organism is an index
+ *	into all of the arrays (positions hold x followed by y).
+ */
+typedef struct {
+	int type;
+	int count; // organisms alive
+	int capacity; // size of the arrays (whole organism type's maximum)
+	int limit; // most organisms this shard may grow to
+	int *positions; // absolute positions
+	float *posF; // relative GL positions
+	int *x_velocity;
+	int *y_velocity;
+	int *total_feeds;
+
+	// statistics
+	int num_eaten;
+	int num_starved;
+	int num_reproductions;
+	int num_births; // organisms added (regrowing species add batches)
+} Population;
+
+
+// rebalance shards every rebalance_interval steps (0 = never)
+int rebalance_interval;
+
+// SUB-STEPPING: organisms move substeps steps between exchanges with
+//	the collision and head nodes (default 1). With more than one, the
+//	collision nodes get each moving organism's starting state instead
+//	of its position, replay its path, and test the swept segments of
+//	every step, so no encounter along the way is missed.
+int substeps;
+
+// PERCEPTION: if perception_radius > 0, the organisms of every
+//	interaction between two moving species get the other species'
+//	positions from the last exchange (ghosts, sent by the interaction's
+//	collision node) and steer by the ones within that many pixels:
+//	prey flee from all predators in range, and predators with no
+//	predator of their own in range chase the nearest prey. Speeds do
+//	not change, only directions.
+int perception_radius;
+
+// LOCALITY: every morton_interval steps (0 = never), sort each
+//	population's arrays into Morton order (see morton.h)
+int morton_interval;
+
+
+/* Organism node methods */
+void run_organism_node();
+
+/* Population methods */
+void init_population(Population *pop, int type, int count,
+	int limit, int capacity);
+void free_population(Population *pop);
+void step_organism(int *x, int *y, int *x_velocity, int *y_velocity);
+void move_population(Population *pop);
+void population_states(Population *pop, int states[]);
+void aim_velocity(int *x_velocity, int *y_velocity, int dx, int dy);
+void steer_population(Population *pop, NeighbourGrid *threats,
+	NeighbourGrid *food);
+void remove_organism(Population *pop, int i, int feeds[], char deaths[]);
+void add_organism(Population *pop);
+void remove_eaten(Population *pop, int feeds[], char deaths[]);
+void update_population(Population *pop, int feeds[], char deaths[], int steps);
+void rebalance_population(Population *pop, double cost);
+void morton_sort_population(Population *pop);
+char *pack_population(char *cursor, Population *pop);
+char *unpack_population(char *cursor, Population *pop);
+
+
+#endif
@@ -0,0 +1,272 @@
+#include "recorder.h"
+
+#include <string.h>
+#include <pthread.h>
+
+
+/* WRITE BUFFERS:
+ *	The head node appends chunks to the active buffer. When it fills
+ *	up, it is handed to the writer thread and the other buffer becomes
+ *	active. Each buffer is either being filled or being written.
+ */
+char *record_buffers[2];
+int record_buffer_size;
+int record_active; // buffer being filled
+int record_fill; // bytes used in the active buffer
+
+// handed-off buffer waiting for (or being written by) the writer thread
+int record_write_pending;
+int record_write_bytes;
+int record_stopping;
+
+FILE *record_file;
+pthread_t record_thread;
+pthread_mutex_t record_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t record_cond = PTHREAD_COND_INITIALIZER;
+
+// statistics of the steps not yet put into a chunk
+RecordStats record_stats[RECORD_STATS_PER_CHUNK];
+int record_stats_count;
+
+
+/* WRITER THREAD: writes handed-off buffers to the file until stopped */
+void *record_writer(void *arg){
+	pthread_mutex_lock(&record_lock);
+	while(1){
+		while(!record_write_pending && !record_stopping){
+			pthread_cond_wait(&record_cond, &record_lock);
+		}
+		if(!record_write_pending && record_stopping)
+			break;
+
+		// write the buffer that is not being filled
+		char *buffer = record_buffers[1 - record_active];
+		int bytes = record_write_bytes;
+		pthread_mutex_unlock(&record_lock);
+		fwrite(buffer, 1, bytes, record_file);
+		pthread_mutex_lock(&record_lock);
+
+		record_write_pending = 0;
+		pthread_cond_broadcast(&record_cond);
+	}
+	pthread_mutex_unlock(&record_lock);
+	return NULL;
+}
+
+
+/* Hands the active buffer to the writer thread, waiting only if the
+ *	previous buffer has not been written yet.
+ */
+void record_swap(){
+	pthread_mutex_lock(&record_lock);
+	while(record_write_pending){
+		pthread_cond_wait(&record_cond, &record_lock);
+	}
+	record_write_bytes = record_fill;
+	record_write_pending = 1;
+	record_active = 1 - record_active;
+	record_fill = 0;
+	pthread_cond_broadcast(&record_cond);
+	pthread_mutex_unlock(&record_lock);
+}
+
+
+/* Appends one chunk (header + payload pieces) to the active buffer.
+ *	Payload is padded to 8 bytes so every chunk stays aligned.
+ */
+void record_chunk(int type, int step, int count,
+		void *pieces[], int sizes[], int num_pieces){
+	RecordChunk chunk;
+	chunk.type = type;
+	chunk.step = step;
+	chunk.count = count;
+	chunk.bytes = 0;
+	int i;
+	for(i=0; i<num_pieces; i++){
+		chunk.bytes += sizes[i];
+	}
+	int padding = (8 - chunk.bytes % 8) % 8;
+	int total = sizeof(RecordChunk) + chunk.bytes + padding;
+
+	if(record_fill + total > record_buffer_size)
+		record_swap();
+
+	// a chunk larger than a whole buffer: grow both buffers (both are
+	//	free once the pending write is done)
+	if(total > record_buffer_size){
+		pthread_mutex_lock(&record_lock);
+		while(record_write_pending){
+			pthread_cond_wait(&record_cond, &record_lock);
+		}
+		pthread_mutex_unlock(&record_lock);
+		record_buffer_size = total;
+		record_buffers[0] = (char*)(realloc(record_buffers[0], total));
+		record_buffers[1] = (char*)(realloc(record_buffers[1], total));
+	}
+
+	char *cursor = &record_buffers[record_active][record_fill];
+	memcpy(cursor, &chunk, sizeof(RecordChunk));
+	cursor += sizeof(RecordChunk);
+	for(i=0; i<num_pieces; i++){
+		memcpy(cursor, pieces[i], sizes[i]);
+		cursor += sizes[i];
+	}
+	memset(cursor, 0, padding);
+	record_fill += total;
+}
+
+
+/* Puts the collected step statistics into a chunk */
+void record_flush_stats(){
+	if(record_stats_count == 0)
+		return;
+	void *pieces[1] = { record_stats };
+	int sizes[1] = { record_stats_count * (int)sizeof(RecordStats) };
+	record_chunk(RECORD_CHUNK_STATS, record_stats[0].step,
+		record_stats_count, pieces, sizes, 1);
+	record_stats_count = 0;
+}
+
+
+/* Fills in the file header this run writes */
+void record_header(RecordHeader *header){
+	memset(header, 0, sizeof(RecordHeader));
+	memcpy(header->magic, RECORD_MAGIC, 8);
+	header->version = RECORD_VERSION;
+	header->window_width = WINDOW_WIDTH;
+	header->window_height = WINDOW_HEIGHT;
+	header->snapshot_interval = snapshot_interval;
+	header->num_types = num_species;
+	int t;
+	for(t=0; t<num_species; t++){
+		header->start_counts[t] = species[t].count;
+		header->colors[t] = species[t].color;
+		memcpy(header->names[t], species[t].name, sizeof(header->names[t]));
+	}
+}
+
+
+/* Initialize RECORDER: open the file (appending if it already holds a
+ *	recording of the same kind, see recorder.h), write the header of a
+ *	new file and the run's first chunk, and start the writer thread.
+ */
+void init_recorder(){
+	if(record_path == NULL)
+		return;
+
+	record_file = fopen(record_path, "a+b");
+	if(record_file == NULL){
+		// organism nodes already send statistics for the recorder
+		printf("Error: could not open recording %s\n", record_path);
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	RecordHeader header;
+	record_header(&header);
+	fseek(record_file, 0, SEEK_END);
+	long existing = ftell(record_file);
+	if(existing > 0){
+		RecordHeader old;
+		rewind(record_file);
+		if(fread(&old, sizeof(old), 1, record_file) != 1 ||
+				memcmp(&old, &header, sizeof(header)) != 0 ||
+				existing % 8 != 0){
+			printf("Error: %s holds a different recording (another ", record_path);
+			printf("version, food web, window or snapshot interval); ");
+			printf("record to a new file.\n");
+			MPI_Abort(MPI_COMM_WORLD, 1);
+		}
+		fseek(record_file, 0, SEEK_END);
+	}
+
+	record_buffer_size = RECORD_BUFFER_SIZE;
+	record_buffers[0] = (char*)(malloc(record_buffer_size));
+	record_buffers[1] = (char*)(malloc(record_buffer_size));
+	record_active = 0;
+	record_fill = 0;
+	record_write_pending = 0;
+	record_stopping = 0;
+	record_stats_count = 0;
+
+	// new file: start with the header
+	if(existing == 0){
+		memcpy(record_buffers[0], &header, sizeof(header));
+		record_fill = sizeof(header);
+	}
+	record_chunk(RECORD_CHUNK_RUN, sim_step, sim_seed, NULL, NULL, 0);
+
+	pthread_create(&record_thread, NULL, record_writer, NULL);
+	printf("Recording to %s (positions every %d steps%s).\n",
+		record_path, snapshot_interval, existing > 0 ? ", appended" : "");
+}
+
+
+/* Records one step of statistics. stats[type] holds the births,
+ *	deaths (eaten) and starvations of that organism type this step.
+ */
+void record_step(int step, int stats[NUMBER_OF_ORGANISMS][3]){
+	if(record_path == NULL)
+		return;
+
+	RecordStats *record = &record_stats[record_stats_count++];
+	record->step = step;
+	int i;
+	for(i=0; i<NUMBER_OF_ORGANISMS; i++){
+		record->population[i] = (i < num_species) ? organism_loc_count[i] : 0;
+		record->births[i] = stats[i][0];
+		record->deaths[i] = stats[i][1];
+		record->starved[i] = stats[i][2];
+	}
+
+	if(record_stats_count == RECORD_STATS_PER_CHUNK)
+		record_flush_stats();
+}
+
+
+/* Records a snapshot of the display buffers (all positions, over the
+ *	whole world: a snapshot report, see world_report in display.h)
+ */
+void record_frame(int step){
+	if(record_path == NULL)
+		return;
+
+	int counts[RECORD_COUNTS_SIZE];
+	void *pieces[1 + NUMBER_OF_ORGANISMS];
+	int sizes[1 + NUMBER_OF_ORGANISMS];
+	int total = 0;
+	memset(counts, 0, sizeof(counts));
+	pieces[0] = counts;
+	sizes[0] = sizeof(counts);
+	int t;
+	for(t=0; t<num_species; t++){
+		counts[t] = organism_view_count[t];
+		pieces[1+t] = organism_locs[t];
+		sizes[1+t] = organism_view_count[t] * 2 * (int)sizeof(float);
+		total += organism_view_count[t];
+	}
+	record_chunk(RECORD_CHUNK_FRAME, step, total, pieces, sizes,
+		1 + num_species);
+}
+
+
+/* Writes out everything still buffered, stops the writer thread and
+ *	closes the file.
+ */
+void close_recorder(){
+	if(record_path == NULL)
+		return;
+
+	record_flush_stats();
+	if(record_fill > 0)
+		record_swap();
+
+	pthread_mutex_lock(&record_lock);
+	record_stopping = 1;
+	pthread_cond_broadcast(&record_cond);
+	pthread_mutex_unlock(&record_lock);
+	pthread_join(record_thread, NULL);
+
+	fclose(record_file);
+	record_path = NULL;
+	printf("Recording closed.\n");
+}
@@ -0,0 +1,99 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+
+/* Contains functions for global operations */
+#include "global.h"
+
+
+/* TRAJECTORY RECORDER (HEAD NODE):
+ *	Appends per-step population statistics, and position snapshots
+ *	every snapshot_interval steps, to an append-only binary file.
+ *	Data is collected into large buffers that a background thread
+ *	writes out, so the simulation never waits on the disk unless the
+ *	writer falls a whole buffer behind.
+ *
+ *	File layout (native byte order, everything 8-byte aligned so the
+ *	file can be memory-mapped and read in place):
+ *		RecordHeader
+ *		RecordChunk + payload, RecordChunk + payload, ...
+ *	Every run recorded starts with a RECORD_CHUNK_RUN chunk. A run may
+ *	append to an existing recording only if its header (version, food
+ *	web, window and snapshot interval) is exactly the one this run
+ *	would write, so the one header describes the whole file.
+ *	Payloads:
+ *		RECORD_CHUNK_RUN: none (step = the run's first step, e.g. after
+ *			a restart; count = its random seed)
+ *		RECORD_CHUNK_STATS: count RecordStats (one per step)
+ *		RECORD_CHUNK_FRAME: int counts[RECORD_COUNTS_SIZE] followed by
+ *			the OpenGL positions (x, y floats) of each organism type,
+ *			in food web order (all of them, scaled to the whole world,
+ *			wherever the viewport was). count = total number of
+ *			organisms in the frame.
+ */
+
+#define RECORD_MAGIC "ENVSIMTR"
+#define RECORD_VERSION 4
+
+#define RECORD_CHUNK_STATS 1
+#define RECORD_CHUNK_FRAME 2
+#define RECORD_CHUNK_RUN 3
+
+// steps of statistics collected into one chunk
+#define RECORD_STATS_PER_CHUNK 256
+
+// organism counts at the start of a frame payload (one per possible
+//	species, a multiple of 8 bytes)
+#define RECORD_COUNTS_SIZE NUMBER_OF_ORGANISMS
+
+// size of each of the two write buffers (grows for very large frames)
+#define RECORD_BUFFER_SIZE (4 * 1024 * 1024)
+
+
+/* FILE HEADER: start of every recording */
+typedef struct {
+	char magic[8];
+	int version;
+	int window_width;
+	int window_height;
+	int snapshot_interval;
+	int num_types; // species in the food web
+	int start_counts[NUMBER_OF_ORGANISMS];
+	int colors[NUMBER_OF_ORGANISMS]; // 0xRRGGBB
+	char names[NUMBER_OF_ORGANISMS][16];
+	int padding; // (keeps the header a multiple of 8 bytes)
+} RecordHeader;
+
+/* CHUNK HEADER: type, first step, number of items, payload bytes */
+typedef struct {
+	int type;
+	int step;
+	int count;
+	int bytes;
+} RecordChunk;
+
+/* STATISTICS of one step, per organism type */
+typedef struct {
+	int step;
+	int population[NUMBER_OF_ORGANISMS];
+	int births[NUMBER_OF_ORGANISMS];
+	int deaths[NUMBER_OF_ORGANISMS]; // eaten
+	int starved[NUMBER_OF_ORGANISMS];
+} RecordStats;
+
+
+// file to record into (NULL = recorder off)
+char *record_path;
+
+// record positions every snapshot_interval steps (0 = statistics only)
+int snapshot_interval;
+
+
+/* Recorder methods */
+void init_recorder();
+void record_step(int step, int stats[NUMBER_OF_ORGANISMS][3]);
+void record_frame(int step);
+void close_recorder();
+
+
+#endif
@@ -0,0 +1,206 @@
+#include "render.h"
+
+#include <string.h>
+
+
+// number of bands the framebuffer is split into while splatting
+#define RENDER_NUM_BANDS \
+	((WINDOW_HEIGHT + RENDER_BAND_HEIGHT - 1) / RENDER_BAND_HEIGHT)
+
+
+/* FRAMEBUFFER:
+ *	One packed 0x00RRGGBB int per pixel, row 0 is the TOP of the
+ *	image (PPM order, the reverse of OpenGL).
+ */
+unsigned int *framebuffer;
+
+// scratch buffers: top-left pixel index of every point, and the same
+//	indices sorted by framebuffer band
+int *splat_index;
+int *splat_sorted;
+int band_start[RENDER_NUM_BANDS + 1];
+
+// one row of RGB bytes, used when writing frames out
+unsigned char *frame_row;
+
+// raw video stream (NULL if frames are written to separate files)
+FILE *video_file;
+
+
+/* Initialize RENDERER: allocate the framebuffer and scratch buffers
+ *	for the largest population, and open the video stream if needed.
+ */
+void init_renderer(){
+	int max_points = 1;
+	int type;
+	for(type=0; type<num_species; type++){
+		if(species[type].count > max_points)
+			max_points = species[type].count;
+	}
+
+	framebuffer = (unsigned int*)(malloc(
+		WINDOW_WIDTH * WINDOW_HEIGHT * sizeof(unsigned int)));
+	splat_index = (int*)(malloc(max_points * sizeof(int)));
+	splat_sorted = (int*)(malloc(max_points * sizeof(int)));
+	frame_row = (unsigned char*)(malloc(WINDOW_WIDTH * 3));
+
+	if(frame_prefix == NULL)
+		frame_prefix = "frame_";
+
+	video_file = NULL;
+	if(video_path != NULL){
+		video_file = fopen(video_path, "wb");
+		if(video_file == NULL)
+			printf("Error: could not open video stream %s\n", video_path);
+	}
+}
+
+
+/* SPLAT KERNEL: draws count points (OpenGL -1..1 coordinates, x followed
+ *	by y) as RENDER_POINT_SIZE squares of the given color.
+ *	1) convert all coordinates to pixel indices (branch-free loop the
+ *		compiler can vectorize)
+ *	2) counting sort the indices by framebuffer band
+ *	3) splat band by band, so writes stay within a few cached rows
+ */
+void splat_points(float *locs, int count, unsigned int color){
+	if(count <= 0)
+		return;
+
+	int max_x = WINDOW_WIDTH - RENDER_POINT_SIZE;
+	int max_y = WINDOW_HEIGHT - RENDER_POINT_SIZE;
+	int band_size = WINDOW_WIDTH * RENDER_BAND_HEIGHT;
+
+	// 1) coordinates to top-left pixel index
+	int i;
+	for(i=0; i<count; i++){
+		int px = (int)((locs[2*i] + 1.0f) * (0.5f * WINDOW_WIDTH))
+			- RENDER_POINT_SIZE/2;
+		int py = (int)((1.0f - locs[2*i+1]) * (0.5f * WINDOW_HEIGHT))
+			- RENDER_POINT_SIZE/2;
+		px = px < 0 ? 0 : (px > max_x ? max_x : px);
+		py = py < 0 ? 0 : (py > max_y ? max_y : py);
+		splat_index[i] = py * WINDOW_WIDTH + px;
+	}
+
+	// 2) counting sort by band
+	memset(band_start, 0, sizeof(band_start));
+	for(i=0; i<count; i++){
+		band_start[splat_index[i] / band_size + 1]++;
+	}
+	int b;
+	for(b=0; b<RENDER_NUM_BANDS; b++){
+		band_start[b+1] += band_start[b];
+	}
+	for(i=0; i<count; i++){
+		int band = splat_index[i] / band_size;
+		splat_sorted[band_start[band]++] = splat_index[i];
+	}
+
+	// 3) splat: every row of a point is one fixed-size copy
+	unsigned int pattern[RENDER_POINT_SIZE];
+	for(i=0; i<RENDER_POINT_SIZE; i++){
+		pattern[i] = color;
+	}
+	for(i=0; i<count; i++){
+		unsigned int *pixel = &framebuffer[splat_sorted[i]];
+		int row;
+		for(row=0; row<RENDER_POINT_SIZE; row++){
+			memcpy(pixel, pattern, sizeof(pattern));
+			pixel += WINDOW_WIDTH;
+		}
+	}
+}
+
+
+/* LOD: draws the density grids into the framebuffer as a heatmap,
+ *	matching display_density() in display.c.
+ */
+void render_density(){
+	// color of every cell, mixed once
+	static unsigned int *cell_colors = NULL;
+	int num_cells = lod_grid_width * lod_grid_height;
+	if(cell_colors == NULL)
+		cell_colors = (unsigned int*)(malloc(num_cells * sizeof(unsigned int)));
+	int i;
+	for(i=0; i<num_cells; i++){
+		cell_colors[i] = lod_color(i);
+	}
+
+	int y;
+	for(y=0; y<WINDOW_HEIGHT; y++){
+		// grid row 0 is the bottom of the window
+		int cy = (WINDOW_HEIGHT - 1 - y) / lod_cell_size;
+		unsigned int *pixel = &framebuffer[y * WINDOW_WIDTH];
+		int x;
+		for(x=0; x<WINDOW_WIDTH; x++){
+			pixel[x] = cell_colors[cy * lod_grid_width + x / lod_cell_size];
+		}
+	}
+}
+
+
+/* Rasterize the current display buffers into the framebuffer, using
+ *	the same colors as display_func (each organism type's own color,
+ *	drawn in food web order).
+ */
+void render_frame(){
+	if(lod_cell_size > 0){
+		render_density();
+		return;
+	}
+
+	memset(framebuffer, 0, WINDOW_WIDTH * WINDOW_HEIGHT * sizeof(unsigned int));
+	int type;
+	for(type=0; type<num_species; type++){
+		splat_points(organism_locs[type], organism_view_count[type],
+			species[type].color);
+	}
+}
+
+
+/* Writes the framebuffer to the given file as a binary PPM (P6) image */
+void write_ppm(FILE *file){
+	fprintf(file, "P6\n%d %d\n255\n", WINDOW_WIDTH, WINDOW_HEIGHT);
+	int y;
+	for(y=0; y<WINDOW_HEIGHT; y++){
+		unsigned int *pixel = &framebuffer[y * WINDOW_WIDTH];
+		int x;
+		for(x=0; x<WINDOW_WIDTH; x++){
+			frame_row[3*x] = (unsigned char)(pixel[x] >> 16);
+			frame_row[3*x+1] = (unsigned char)(pixel[x] >> 8);
+			frame_row[3*x+2] = (unsigned char)(pixel[x]);
+		}
+		fwrite(frame_row, 1, WINDOW_WIDTH * 3, file);
+	}
+}
+
+
+/* Exports the last rendered frame, either appended to the video stream
+ *	or as its own numbered PPM file.
+ */
+void export_frame(int step){
+	if(video_file != NULL){
+		write_ppm(video_file);
+		return;
+	}
+
+	char path[512];
+	snprintf(path, sizeof(path), "%s%06d.ppm", frame_prefix, step);
+	FILE *file = fopen(path, "wb");
+	if(file == NULL){
+		printf("Error: could not write frame %s\n", path);
+		return;
+	}
+	write_ppm(file);
+	fclose(file);
+}
+
+
+/* Flush and close the video stream (if any) */
+void close_renderer(){
+	if(video_file != NULL){
+		fclose(video_file);
+		video_file = NULL;
+	}
+}
@@ -0,0 +1,42 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+
+/* Contains functions for global operations */
+#include "global.h"
+
+
+/* OFFSCREEN RENDERER:
+ *	Rasterizes the display buffers into an in-memory framebuffer on the
+ *	head node, so frames can be exported without an X server or GLUT
+ *	window (e.g. from batch jobs on compute nodes).
+ */
+
+// size of each rendered point in pixels (same as glPointSize in display.c)
+#define RENDER_POINT_SIZE 4
+
+// number of framebuffer rows rasterized together (keeps the rows being
+//	written to in cache while splatting)
+#define RENDER_BAND_HEIGHT 16
+
+
+// HEADLESS MODE: 1 if the head node runs without a GLUT window
+int headless;
+
+// export a frame every frame_interval steps (0 = no frame export)
+int frame_interval;
+
+// frame output: files named <frame_prefix>NNNNNN.ppm, or (if set) one
+//	raw stream of concatenated PPM frames in video_path
+char *frame_prefix;
+char *video_path;
+
+
+/* Renderer methods */
+void init_renderer();
+void render_frame();
+void export_frame(int step);
+void close_renderer();
+
+
+#endif
@@ -0,0 +1,338 @@
+#include "replay.h"
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+// the memory-mapped recording
+char *replay_data;
+size_t replay_size;
+
+// FRAME INDEX: file offset and step of every position snapshot, and
+//	the first snapshot of every run (plus one past the last), each
+//	run's steps growing
+size_t *replay_offsets;
+int *replay_steps;
+int replay_num_frames;
+int *replay_run_first;
+int replay_num_runs;
+int replay_run; // run on screen
+
+// playback state
+int replay_frame; // snapshot on screen
+int replay_speed; // snapshots per REPLAY_FPS tick
+int replay_paused;
+int replay_clock_frame; // snapshot shown at replay_clock_time
+int replay_clock_time; // GLUT time (ms) playback last (re)started
+
+
+/* Whether a snapshot's payload holds what its counts say: the counts
+ *	themselves (none below 0), then that many x, y pairs of every type.
+ */
+int frame_fits(RecordChunk *chunk){
+	if(chunk->bytes < (int)(RECORD_COUNTS_SIZE * sizeof(int)))
+		return 0;
+	int *counts = (int*)((char*)chunk + sizeof(RecordChunk));
+	long long bytes = RECORD_COUNTS_SIZE * sizeof(int);
+	int t;
+	for(t=0; t<num_species; t++){
+		if(counts[t] < 0)
+			return 0;
+		bytes += (long long)counts[t] * 2 * sizeof(float);
+	}
+	return bytes <= chunk->bytes;
+}
+
+
+/* Walks the chunks of the mapped recording and builds the frame index.
+ *	Also makes sure every indexed snapshot's payload holds all the
+ *	positions its counts say (see frame_fits).
+ *	Returns 0 if the file is not a valid recording.
+ */
+int build_frame_index(){
+	if(replay_size < sizeof(RecordHeader))
+		return 0;
+	RecordHeader *header = (RecordHeader*)replay_data;
+	if(memcmp(header->magic, RECORD_MAGIC, 8) != 0 ||
+			header->version != RECORD_VERSION ||
+			header->num_types < 1 || header->num_types > NUMBER_OF_ORGANISMS){
+		return 0;
+	}
+
+	// the recorded food web's species (everything the display needs)
+	num_species = header->num_types;
+	int t;
+	for(t=0; t<num_species; t++){
+		memset(&species[t], 0, sizeof(Species));
+		memcpy(species[t].name, header->names[t], sizeof(species[t].name) - 1);
+		species[t].count = header->start_counts[t];
+		species[t].color = header->colors[t];
+	}
+
+	// first pass: count the snapshots (and runs)
+	size_t offset = sizeof(RecordHeader);
+	int frames = 0;
+	int runs = 0;
+	while(offset + sizeof(RecordChunk) <= replay_size){
+		RecordChunk *chunk = (RecordChunk*)&replay_data[offset];
+		size_t next = offset + sizeof(RecordChunk)
+			+ chunk->bytes + (8 - chunk->bytes % 8) % 8;
+		if(chunk->bytes < 0 || next > replay_size)
+			break; // cut off (e.g. the run was killed mid-write)
+		if(chunk->type == RECORD_CHUNK_FRAME){
+			if(!frame_fits(chunk)){
+				printf("Warning: snapshot at step %d is corrupt, ", chunk->step);
+				printf("replaying the %d before it.\n", frames);
+				break;
+			}
+			frames++;
+		}
+		if(chunk->type == RECORD_CHUNK_RUN)
+			runs++;
+		offset = next;
+	}
+
+	// second pass: fill the index
+	replay_offsets = (size_t*)(malloc((frames + 1) * sizeof(size_t)));
+	replay_steps = (int*)(malloc((frames + 1) * sizeof(int)));
+	replay_run_first = (int*)(malloc((runs + frames + 2) * sizeof(int)));
+	replay_num_frames = 0;
+	replay_num_runs = 0;
+	offset = sizeof(RecordHeader);
+	while(replay_num_frames < frames){
+		RecordChunk *chunk = (RecordChunk*)&replay_data[offset];
+
+		// a new run (runs without snapshots are left out), or steps
+		//	going back without one
+		int new_run = (chunk->type == RECORD_CHUNK_RUN) ||
+			(chunk->type == RECORD_CHUNK_FRAME && replay_num_frames > 0 &&
+			chunk->step < replay_steps[replay_num_frames-1]);
+		if(new_run || replay_num_runs == 0){
+			if(replay_num_runs == 0 ||
+					replay_run_first[replay_num_runs-1] < replay_num_frames)
+				replay_num_runs++;
+			replay_run_first[replay_num_runs-1] = replay_num_frames;
+		}
+
+		if(chunk->type == RECORD_CHUNK_FRAME){
+			replay_offsets[replay_num_frames] = offset;
+			replay_steps[replay_num_frames] = chunk->step;
+			replay_num_frames++;
+
+			// counts can be larger than the start (e.g. an appended run)
+			int *counts = (int*)&replay_data[offset + sizeof(RecordChunk)];
+			for(t=0; t<num_species; t++){
+				if(counts[t] > species[t].count)
+					species[t].count = counts[t];
+			}
+		}
+		offset += sizeof(RecordChunk)
+			+ chunk->bytes + (8 - chunk->bytes % 8) % 8;
+	}
+	replay_run_first[replay_num_runs] = replay_num_frames;
+	return 1;
+}
+
+
+/* Returns the index of the last snapshot at or before the given step
+ *	of the run on screen (binary search over its part of the frame
+ *	index; steps only grow within a run).
+ */
+int replay_seek(int step){
+	int low = replay_run_first[replay_run];
+	int high = replay_run_first[replay_run + 1] - 1;
+	while(low < high){
+		int mid = (low + high + 1) / 2;
+		if(replay_steps[mid] <= step)
+			low = mid;
+		else
+			high = mid - 1;
+	}
+	return low;
+}
+
+
+/* Points the display buffers at the given snapshot (no copying) */
+void replay_show(int frame){
+	if(frame < 0)
+		frame = 0;
+	if(frame >= replay_num_frames)
+		frame = replay_num_frames - 1;
+	replay_frame = frame;
+	replay_run = 0;
+	while(replay_run_first[replay_run + 1] <= frame){
+		replay_run++;
+	}
+
+	char *payload = &replay_data[replay_offsets[frame] + sizeof(RecordChunk)];
+	int *counts = (int*)payload;
+	float *locs = (float*)(payload + RECORD_COUNTS_SIZE * sizeof(int));
+	int t;
+	for(t=0; t<num_species; t++){
+		organism_loc_count[t] = counts[t];
+		organism_view_count[t] = counts[t];
+		organism_locs[t] = locs;
+		locs += 2 * counts[t];
+	}
+	sim_step = replay_steps[frame];
+}
+
+
+/* Restart the playback clock from the snapshot on screen */
+void replay_reset_clock(){
+	replay_clock_frame = replay_frame;
+	replay_clock_time = glutGet(GLUT_ELAPSED_TIME);
+}
+
+
+/* GLUT IDLE FUNCTION (REPLAY): show the snapshot that playback has
+ *	reached, REPLAY_FPS * replay_speed snapshots per second.
+ */
+void replay_idle_func(){
+	if(replay_clock_time < 0)
+		replay_reset_clock();
+	
+	if(!replay_paused){
+		int elapsed = glutGet(GLUT_ELAPSED_TIME) - replay_clock_time;
+		int frame = replay_clock_frame
+			+ (int)((long)elapsed * REPLAY_FPS * replay_speed / 1000);
+		int last = replay_run_first[replay_run + 1] - 1;
+		if(frame >= last){
+			frame = last;
+			replay_paused = 1;
+		}
+		if(frame != replay_frame)
+			replay_show(frame);
+	}
+
+	char title[128];
+	int first = replay_run_first[replay_run];
+	snprintf(title, sizeof(title),
+		"EnvSim Replay - run %d/%d step %d (%d/%d) x%d%s", replay_run + 1,
+		replay_num_runs, sim_step, replay_frame - first + 1,
+		replay_run_first[replay_run + 1] - first, replay_speed,
+		replay_paused ? " [paused]" : "");
+	glutSetWindowTitle(title);
+	glutPostRedisplay();
+}
+
+
+/* GLUT KEYBOARD FUNCTION (REPLAY): playback controls (see replay.h) */
+void replay_keyboard_func(unsigned char key, int x, int y){
+	if(key == 'q' || key == 27){
+		exit(0);
+	}
+	else if(key == ' '){
+		replay_paused = !replay_paused;
+	}
+	else if(key == '+' || key == '='){
+		replay_speed *= 2;
+	}
+	else if(key == '-' && replay_speed > 1){
+		replay_speed /= 2;
+	}
+	else if(key == '['){
+		replay_show(replay_frame - 1);
+	}
+	else if(key == ']'){
+		replay_show(replay_frame + 1);
+	}
+	else if(key == '<' || key == ','){
+		replay_show(replay_frame - 10);
+	}
+	else if(key == '>' || key == '.'){
+		replay_show(replay_frame + 10);
+	}
+	else if(key >= '0' && key <= '9'){
+		int first_step = replay_steps[replay_run_first[replay_run]];
+		int last_step = replay_steps[replay_run_first[replay_run + 1] - 1];
+		replay_show(replay_seek(
+			first_step + (last_step - first_step) * (key - '0') / 10));
+	}
+	else if(key == 'n' && replay_run + 1 < replay_num_runs){
+		replay_show(replay_run_first[replay_run + 1]);
+	}
+	else if(key == 'p' && replay_run > 0){
+		replay_show(replay_run_first[replay_run - 1]);
+	}
+	replay_reset_clock();
+}
+
+
+/* GLUT CLOSE FUNCTION (REPLAY): nothing to shut down but the program */
+void replay_close_func(){
+	exit(0);
+}
+
+
+/* HEADLESS REPLAY: export every frame_interval-th snapshot (of the
+ *	run shown)
+ */
+void replay_headless(){
+	init_renderer();
+	int exported = 0;
+	int last = replay_run_first[replay_run + 1];
+	int frame;
+	for(frame=replay_frame; frame<last; frame+=frame_interval){
+		replay_show(frame);
+		render_frame();
+		export_frame(sim_step);
+		exported++;
+	}
+	close_renderer();
+	printf("Exported %d snapshots.\n", exported);
+}
+
+
+/* REPLAY MODE: map the recording, index its snapshots, and play them
+ *	back from replay_start_step.
+ */
+void start_replay(int argc, char **argv){
+	int file = open(replay_path, O_RDONLY);
+	struct stat info;
+	if(file < 0 || fstat(file, &info) != 0){
+		printf("Error: could not open recording %s\n", replay_path);
+		exit(1);
+	}
+	replay_size = info.st_size;
+	replay_data = (char*)mmap(NULL, replay_size, PROT_READ, MAP_SHARED, file, 0);
+	close(file);
+	if(replay_data == MAP_FAILED || !build_frame_index()){
+		printf("Error: %s is not a recording.\n", replay_path);
+		exit(1);
+	}
+	if(replay_num_frames == 0){
+		printf("Error: %s has no position snapshots ", replay_path);
+		printf("(record with -snapshot #).\n");
+		exit(1);
+	}
+	if(replay_start_run > replay_num_runs){
+		printf("Error: %s holds %d runs.\n", replay_path, replay_num_runs);
+		exit(1);
+	}
+	replay_run = (replay_start_run > 0) ? replay_start_run - 1 : 0;
+	int first = replay_run_first[replay_run];
+	int last = replay_run_first[replay_run + 1] - 1;
+	printf("Replaying %s: run %d of %d, %d snapshots, steps %d to %d.\n",
+		replay_path, replay_run + 1, replay_num_runs, last - first + 1,
+		replay_steps[first], replay_steps[last]);
+
+	lod_cell_size = 0;
+	replay_speed = 1;
+	replay_paused = 0;
+	replay_show(replay_seek(replay_start_step));
+
+	if(headless && frame_interval > 0){
+		replay_headless();
+		return;
+	}
+
+	// play back through the normal display function (the playback
+	//	clock starts with the first idle call, once GLUT is running)
+	replay_clock_time = -1;
+	init_window(argc, argv, "EnvSim Replay",
+		replay_idle_func, replay_keyboard_func, replay_close_func);
+}
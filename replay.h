@@ -0,0 +1,45 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+
+/* Contains functions for global operations */
+#include "global.h"
+
+
+/* REPLAY VIEWER:
+ *	Plays back the position snapshots of a recording (see recorder.h)
+ *	through the normal display, without starting MPI or any worker
+ *	nodes. The file is memory-mapped and the display buffers point
+ *	straight into it, so showing (or seeking to) any snapshot costs
+ *	nothing more than looking up its offset in the frame index.
+ *
+ *	A recording may hold several runs (appended, see recorder.h); one
+ *	run is played at a time, and seeking stays within it.
+ *
+ *	Keys: space = pause, +/- = faster/slower, [ ] = one snapshot
+ *	back/forward, < > = 10 snapshots back/forward, 0-9 = jump to
+ *	0%-90% of the run, n / p = next / previous run, q / escape = quit.
+ *	In headless mode (-frames #) every #-th snapshot is exported with
+ *	the offscreen renderer instead.
+ */
+
+// snapshots shown per second at speed 1
+#define REPLAY_FPS 30
+
+
+// recording to replay (NULL = simulate as usual)
+char *replay_path;
+
+// step to start playback at (the closest snapshot at or before it),
+//	and run to play (1 = the first, also when 0)
+int replay_start_step;
+int replay_start_run;
+
+
+/* Replay methods */
+void start_replay(int argc, char **argv);
+int replay_seek(int step);
+void replay_show(int frame);
+
+
+#endif
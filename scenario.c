@@ -0,0 +1,100 @@
+#include "global.h" // (includes scenario.h)
+
+#include <string.h>
+
+
+/* Reads the settings of a scenario file (see scenario.h) into text, as
+ *	words that each end in '\0' (argument, value, argument, ...), and
+ *	notes in has_web whether the file also holds a food web. Returns
+ *	the length of the text, or -1 (after printing what is wrong) if the
+ *	scenario cannot be used.
+ */
+int read_scenario(char *path, char text[], int *has_web){
+	FILE *file = fopen(path, "r");
+	if(file == NULL){
+		printf("Error: could not open scenario %s\n", path);
+		return -1;
+	}
+	*has_web = 0;
+	char line[256];
+	int line_number = 0;
+	int length = 0;
+	while(length >= 0 && fgets(line, sizeof(line), file) != NULL){
+		line_number++;
+		char *comment = strchr(line, '#');
+		if(comment != NULL)
+			*comment = '\0';
+		char argument[64], value[192], extra[2];
+		int read = sscanf(line, "%63s %191s %1s", argument, value, extra);
+		if(read < 1)
+			continue; // blank line
+		if(strcmp(argument, "species") == 0 || strcmp(argument, "eats") == 0){
+			*has_web = 1; // checked by read_foodweb
+			continue;
+		}
+		if(argument[0] != '-' || read != 2){
+			printf("Error: %s line %d: expected -<argument> <value>\n",
+				path, line_number);
+			length = -1;
+		}
+		else if(strcmp(argument, "-scenario") == 0 ||
+				strcmp(argument, "-replay") == 0){
+			printf("Error: %s line %d: %s only works on the command line\n",
+				path, line_number, argument);
+			length = -1;
+		}
+		else if(length + strlen(argument) + strlen(value) + 2 > SCENARIO_MAX_TEXT){
+			printf("Error: scenario %s is too long\n", path);
+			length = -1;
+		}
+		else{
+			strcpy(&text[length], argument);
+			length += strlen(argument) + 1;
+			strcpy(&text[length], value);
+			length += strlen(value) + 1;
+		}
+	}
+	fclose(file);
+	return length;
+}
+
+
+/* ALL NODES (right after MPI_Init, before the food web): node 0 reads
+ *	the scenario (if any) and sends its settings to every node, which
+ *	applies them and then its command line again (so that wins).
+ */
+void init_scenario(int argc, char **argv){
+	if(scenario_path == NULL)
+		return;
+	int world_rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+
+	// the text stays: text settings (file names) point into it
+	char *text = (char*)malloc(SCENARIO_MAX_TEXT);
+	int header[2]; // length of the text (-1 = invalid), has a food web
+	if(world_rank == 0)
+		header[0] = read_scenario(scenario_path, text, &header[1]);
+	MPI_Bcast(header, 2, MPI_INT, 0, MPI_COMM_WORLD);
+	if(header[0] < 0)
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	MPI_Bcast(text, header[0], MPI_CHAR, 0, MPI_COMM_WORLD);
+
+	// split the text back into arguments
+	char *arguments[SCENARIO_MAX_TEXT / 2];
+	int num_arguments = 0;
+	int offset = 0;
+	while(offset < header[0]){
+		arguments[num_arguments++] = &text[offset];
+		offset += strlen(&text[offset]) + 1;
+	}
+
+	if(world_rank == 0)
+		printf("Scenario %s: %d settings.\n", scenario_path, num_arguments / 2);
+	if(!process_args(num_arguments, arguments) ||
+			!process_args(argc - 1, &argv[1]))
+		MPI_Abort(MPI_COMM_WORLD, 1);
+
+	// food web of the scenario itself (unless another is named)
+	if(header[1] && foodweb_path == NULL)
+		foodweb_path = scenario_path;
+}
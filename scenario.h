@@ -0,0 +1,39 @@
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+
+/* SCENARIO FILES:
+ *	A scenario holds the settings of a run in one file: node 0 reads
+ *	and checks it right after MPI_Init, and sends the settings to every
+ *	node, so a job started without arguments (make run) or on hosts
+ *	that cannot see the file still runs the same scenario everywhere.
+ *	Settings are command line arguments, one per line; arguments given
+ *	on the command line win over the scenario's. The file may also hold
+ *	a food web (species and eats lines, see foodweb.h), used unless
+ *	-foodweb names another. Anything after a '#' is a comment.
+ *	e.g.
+ *		-seed 5
+ *		-steps 300
+ *		-perceive 20
+ *		species plants     100000  0 30  0     0 00FF00
+ *		species herbivores   2000 10  0 10  -100 0000FF
+ *		eats herbivores plants 2
+ *	-replay (and -scenario itself) only work on the command line.
+ */
+
+// most text of a scenario's settings (all of their words)
+#define SCENARIO_MAX_TEXT 16384
+
+// file to read the scenario from (NULL = none)
+char *scenario_path;
+
+
+/* Scenario methods */
+void init_scenario(int argc, char **argv);
+int read_scenario(char *path, char text[], int *has_web);
+
+/* applies command line arguments (in envsim.c); 0 if they are wrong */
+int process_args(int argc, char **argv);
+
+
+#endif
@@ -0,0 +1,129 @@
+#include "global.h" // (includes telemetry.h)
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+
+
+// the mapped page (NULL when telemetry is off), and the counters
+//	collected since the last publish
+TelemetryPage *telemetry_page = NULL;
+TelemetryPage telemetry_counters;
+
+// time the current phase started
+double telemetry_mark;
+
+
+/* Wall clock time in seconds (comparable between processes) */
+double telemetry_clock(){
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return now.tv_sec + now.tv_usec / 1000000.0;
+}
+
+
+/* ALL NODES (after init_layout): create and map this node's stats page */
+void init_telemetry(){
+	if(telemetry_dir == NULL)
+		return;
+
+	char *path = (char*)(malloc(strlen(telemetry_dir) + 48));
+	if(ensemble_path != NULL)
+		sprintf(path, "%s/g%d.node%d.stats", telemetry_dir, ensemble_group, rank);
+	else
+		sprintf(path, "%s/node%d.stats", telemetry_dir, rank);
+
+	int file = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if(file < 0 || ftruncate(file, sizeof(TelemetryPage)) != 0){
+		printf("Warning: could not create stats page %s\n", path);
+		if(file >= 0)
+			close(file);
+		free(path);
+		return;
+	}
+	void *mapped = mmap(NULL, sizeof(TelemetryPage), PROT_READ | PROT_WRITE,
+		MAP_SHARED, file, 0);
+	close(file);
+	free(path);
+	if(mapped == MAP_FAILED){
+		printf("Warning: could not map stats page of node %d\n", rank);
+		return;
+	}
+	telemetry_page = (TelemetryPage*)mapped;
+
+	memset(&telemetry_counters, 0, sizeof(TelemetryPage));
+	telemetry_counters.magic = TELEMETRY_MAGIC;
+	telemetry_counters.version = TELEMETRY_VERSION;
+	telemetry_counters.rank = rank;
+	telemetry_counters.group = ensemble_group;
+	telemetry_counters.role = node_role;
+	telemetry_counters.type = organism_type;
+	if(node_role == ROLE_ORGANISM){
+		strncpy(telemetry_counters.type_name, species[organism_type].name,
+			sizeof(telemetry_counters.type_name) - 1);
+	}
+	telemetry_counters.shard = shard_index;
+	telemetry_counters.pid = (int)getpid();
+	telemetry_mark = MPI_Wtime();
+	telemetry_publish(0, 0, 0, 0);
+}
+
+
+/* Adds the time since the last call to the given phase (the one that
+ *	just ended).
+ */
+void telemetry_phase(int phase){
+	counters_phase(phase); // hardware counters (if enabled) share the marks
+	if(telemetry_page == NULL)
+		return;
+	double now = MPI_Wtime();
+	telemetry_counters.phase_seconds[phase] += now - telemetry_mark;
+	telemetry_mark = now;
+}
+
+
+/* Counts one message of the given size sent by this node */
+void telemetry_sent(int bytes){
+	if(telemetry_page == NULL)
+		return;
+	telemetry_counters.messages_sent++;
+	telemetry_counters.bytes_sent += bytes;
+}
+
+
+/* Copies the counters (and the given progress values) into the stats
+ *	page, under the seqlock.
+ */
+void telemetry_publish(int step, int population,
+		long long births, long long deaths){
+	if(telemetry_page == NULL)
+		return;
+	telemetry_counters.step = step;
+	telemetry_counters.population = population;
+	telemetry_counters.births = births;
+	telemetry_counters.deaths = deaths;
+	telemetry_counters.updated = telemetry_clock();
+
+	unsigned int sequence = telemetry_page->sequence;
+	__atomic_store_n(&telemetry_page->sequence, sequence + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	telemetry_counters.sequence = sequence + 1;
+	memcpy(telemetry_page, &telemetry_counters, sizeof(TelemetryPage));
+	__atomic_store_n(&telemetry_page->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+
+/* ALL NODES (when done): mark the page as done and unmap it (the file
+ *	stays, with the final counters).
+ */
+void telemetry_finish(){
+	if(telemetry_page == NULL)
+		return;
+	telemetry_counters.done = 1;
+	telemetry_publish(telemetry_counters.step, telemetry_counters.population,
+		telemetry_counters.births, telemetry_counters.deaths);
+	munmap(telemetry_page, sizeof(TelemetryPage));
+	telemetry_page = NULL;
+}
@@ -0,0 +1,75 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+
+/* TELEMETRY:
+ *	If telemetry_dir is set, every node keeps a stats page up to date
+ *	in a small memory-mapped file, <dir>/node<rank>.stats (or
+ *	<dir>/g<group>.node<rank>.stats in ensemble mode). Counters are
+ *	collected in memory during a step and copied into the page once
+ *	per step, so the nodes never print or block on a reader.
+ *
+ *	The page is protected by a seqlock: the writer makes sequence odd,
+ *	writes, then makes it even again. A reader copies the page and
+ *	keeps the copy only if sequence was the same even number before
+ *	and after (see monitor.c, which reads every page in a directory).
+ *
+ *	This header does not depend on the rest of the simulator, so the
+ *	monitor can be built on its own.
+ */
+
+#define TELEMETRY_MAGIC 0x54564E45 // "ENVT"
+#define TELEMETRY_VERSION 2
+
+// phases timed on every node (seconds spent in each since the start)
+#define PHASE_RECEIVE 0 // waiting for and receiving messages
+#define PHASE_UPDATE 1 // applying reports, rebalancing, sorting
+#define PHASE_MOVE 2 // steering and moving organisms
+#define PHASE_COLLIDE 3 // collision tests
+#define PHASE_SEND 4 // sending messages and checkpoints
+#define PHASE_DISPLAY 5 // head node: drawing and recording
+#define NUM_PHASES 6
+
+typedef struct{
+	unsigned int magic;
+	int version;
+	unsigned int sequence; // odd while the page is being written
+
+	// which node this is
+	int rank;
+	int group; // ensemble group (0 outside ensemble mode)
+	int role; // ROLE_* (see mpi_system.h)
+	int type; // organism type (organism nodes)
+	char type_name[16]; // its species' name
+	int shard;
+	int pid;
+	int done; // 1 once the node has stopped
+
+	// progress
+	int step;
+	int population; // organisms on (or seen by) this node
+	long long births;
+	long long deaths;
+
+	// traffic and time
+	long long messages_sent;
+	long long bytes_sent;
+	double phase_seconds[NUM_PHASES];
+	double updated; // wall clock time of the last update (seconds)
+} TelemetryPage;
+
+
+// directory to publish stats pages in (NULL = off)
+char *telemetry_dir;
+
+
+/* Telemetry methods (every node) */
+void init_telemetry();
+void telemetry_phase(int phase);
+void telemetry_sent(int bytes);
+void telemetry_publish(int step, int population,
+	long long births, long long deaths);
+void telemetry_finish();
+
+
+#endif